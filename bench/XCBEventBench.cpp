@@ -0,0 +1,367 @@
+// Headless benchmarks for the XCB event path. Starts a private Xvfb, injects input through
+// XTEST and window configuration requests from a second connection, times framebuffer
+// presentation and a clipboard transfer between two windows, and prints one JSON object per
+// benchmark on stdout so runs can be diffed across commits.
+//
+//  usage: aer_linux_bench [events_per_storm]
+
+#include <Graphics/XCBFramebuffer.h>
+#include <Graphics/XCBWindow.h>
+#include <Input/EventPool.h>
+
+#include <Events/WindowEvents.h>
+
+#include <xcb/xtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+//-----------------------------------------------------------------------------------------------//
+//                                   ALLOCATION COUNTING                                         //
+//-----------------------------------------------------------------------------------------------//
+namespace
+{
+    std::atomic<uint64_t> heap_allocations{ 0 };
+
+    void* counted_alloc( std::size_t size, std::size_t align )
+    {
+        heap_allocations.fetch_add( 1, std::memory_order_relaxed );
+        size = size ? ( size + align - 1 ) / align * align : align;
+        if( auto ptr = std::aligned_alloc( align, size ) ) return ptr;
+        throw std::bad_alloc();
+    }
+}
+
+void* operator new( std::size_t size )                              { return counted_alloc( size, alignof( std::max_align_t ) ); }
+void* operator new( std::size_t size, std::align_val_t align )      { return counted_alloc( size, static_cast<std::size_t>( align ) ); }
+void  operator delete( void* ptr ) noexcept                         { std::free( ptr ); }
+void  operator delete( void* ptr, std::size_t ) noexcept            { std::free( ptr ); }
+void  operator delete( void* ptr, std::align_val_t ) noexcept       { std::free( ptr ); }
+void  operator delete( void* ptr, std::size_t, std::align_val_t ) noexcept { std::free( ptr ); }
+
+namespace aer::bench
+{
+
+using clock = std::chrono::steady_clock;
+
+//-----------------------------------------------------------------------------------------------//
+//                                   XVFB                                                        //
+//-----------------------------------------------------------------------------------------------//
+struct xvfb_t
+{
+    pid_t       pid = -1;
+    std::string display;
+
+    xvfb_t()
+    {
+        int ready[2];
+        if( pipe( ready ) != 0 ) ABORT_F( "Failed to create Xvfb pipe" );
+
+        // -displayfd picks a free display and writes its number once the server accepts clients
+        const auto fd = std::to_string( ready[1] );
+        const char* argv[] = { "Xvfb", "-displayfd", fd.c_str(), "-screen", "0", "1280x720x24", "-nolisten", "tcp", nullptr };
+        if( posix_spawnp( &pid, "Xvfb", nullptr, nullptr, const_cast<char**>( argv ), environ ) != 0 ) ABORT_F( "Failed to start Xvfb" );
+        close( ready[1] );
+
+        char number[16]{};
+        const auto length = read( ready[0], number, sizeof( number ) - 1 );
+        close( ready[0] );
+        if( length <= 0 ) ABORT_F( "Xvfb did not report a display" );
+        display = ":" + std::string( number, strcspn( number, "\n" ) );
+    }
+
+    ~xvfb_t()
+    {
+        if( pid <= 0 ) return;
+        kill( pid, SIGTERM );
+        waitpid( pid, nullptr, 0 );
+    }
+};
+
+//-----------------------------------------------------------------------------------------------//
+//                                   REPORTING                                                   //
+//-----------------------------------------------------------------------------------------------//
+struct result_t
+{
+    const char* name;
+    uint64_t    events;
+    double      seconds;
+    uint64_t    allocations;
+    uint64_t    pool_allocations;
+    uint64_t    list_nodes;         // heap allocations the Events list made, one per event object
+};
+
+void report( const result_t& result )
+{
+    const double events = result.events ? static_cast<double>( result.events ) : 1.0;
+    std::printf
+    (
+        "{\"bench\":\"%s\",\"events\":%llu,\"seconds\":%.6f,\"events_per_sec\":%.0f,\"ns_per_event\":%.1f,"
+        "\"allocs_per_event\":%.4f,\"pool_allocs_per_event\":%.4f,\"list_node_allocs_per_event\":%.4f}\n",
+        result.name, static_cast<unsigned long long>( result.events ), result.seconds,
+        result.events / result.seconds, result.seconds * 1e9 / events,
+        result.allocations / events, result.pool_allocations / events, result.list_nodes / events
+    );
+}
+
+//-----------------------------------------------------------------------------------------------//
+//                                   STORMS                                                      //
+//-----------------------------------------------------------------------------------------------//
+void sync( xcb_connection_t* connection )
+{
+    free( xcb_get_input_focus_reply( connection, xcb_get_input_focus( connection ), nullptr ) );
+}
+
+// injects a storm, then drains the window until done reports every injected event delivered
+template<typename Inject, typename Done>
+result_t run_storm( const char* name, XCBWindow& window, xcb_connection_t* injector, uint64_t count, Inject&& inject, Done&& done )
+{
+    Events events;
+    uint64_t objects = 0;
+    const auto drain = [&]( uint64_t& delivered )
+    {
+        const auto deadline = clock::now() + std::chrono::seconds( 5 );
+        delivered = 0;
+        while( clock::now() < deadline )
+        {
+            window.WaitEvents( events, std::chrono::milliseconds( 100 ) );
+            for( auto& event : events ) delivered += done( event.get() );
+            objects += events.size();
+            events.clear();
+            if( delivered >= count ) return;
+        }
+    };
+
+    // a warm-up pass fills the event pools and vector capacities
+    uint64_t delivered = 0;
+    inject( count );
+    sync( injector );
+    drain( delivered );
+
+    inject( count );
+    sync( injector );
+
+    const auto heap_before  = heap_allocations.load();
+    const auto pool_before  = event_pool::stats().allocations;
+    const auto start        = clock::now();
+    objects                 = 0;
+    drain( delivered );
+    const auto seconds      = std::chrono::duration<double>( clock::now() - start ).count();
+
+    const auto pool_allocations = event_pool::stats().allocations - pool_before;
+    LOG_IF_F( WARNING, delivered < count, "%s: only %llu of %llu events arrived", name, (unsigned long long)delivered, (unsigned long long)count );
+    LOG_IF_F( WARNING, pool_allocations != 0, "%s: %llu event objects came from the heap after warm-up", name, (unsigned long long)pool_allocations );
+    // event objects are pooled, but every one still takes a list node in Events
+    return { name, delivered, seconds, heap_allocations.load() - heap_before, pool_allocations, objects };
+}
+
+// full frames and small dirty rects, through MIT-SHM and through the socket
+void run_present( XCBWindow& window, uint64_t frames )
+{
+    const auto display = window.Connection();
+    const auto depth   = display->Screen( 0 )->root_depth;
+    const framebuffer_rect_t dirty[] = { { 64, 64, 64, 64 } };
+
+    for( const bool shm : { true, false } )
+    {
+        ref_ptr<XCBFramebuffer> framebuffer( new XCBFramebuffer( display, window.NativeWindow(), depth, 640, 480, shm ) );
+        if( shm && !framebuffer->Shared() ) LOG_F( WARNING, "MIT-SHM unavailable; shm results use the socket path" );
+
+        for( const bool partial : { false, true } )
+        {
+            const auto frame = [&]( uint64_t i )
+            {
+                auto pixels = framebuffer->Pixels();
+                pixels[( i * 4099 ) % pixels.size()] = static_cast<uint32_t>( i );
+                framebuffer->Present( partial ? std::span( dirty ) : std::span<const framebuffer_rect_t>() );
+            };
+
+            for( uint64_t i = 0; i < frames / 10; ++i ) frame( i );
+            framebuffer->Pixels();
+            sync( display->Native() );
+
+            const auto heap_before = heap_allocations.load();
+            const auto start       = clock::now();
+            for( uint64_t i = 0; i < frames; ++i ) frame( i );
+            framebuffer->Pixels();
+            sync( display->Native() );
+            const auto seconds     = std::chrono::duration<double>( clock::now() - start ).count();
+
+            static constexpr const char* names[2][2] = { { "present_full_socket", "present_dirty_socket" }, { "present_full_shm", "present_dirty_shm" } };
+            report( { names[shm][partial], frames, seconds, heap_allocations.load() - heap_before, 0, 0 } );
+        }
+    }
+}
+
+// a multi-megabyte clipboard copied between two windows of the same display, which has to go
+// through INCR; both are polled, as each only hears its own side of the transfer
+void run_selection( XCBWindow& owner, XCBWindow& requestor, size_t bytes )
+{
+    using namespace aer::xcb;
+    auto& atoms = owner.Connection()->Atoms();
+    std::vector<std::byte> payload( bytes );
+    for( size_t i = 0; i < bytes; ++i ) payload[i] = static_cast<std::byte>( 'a' + i % 26 );
+    owner.SetSelection( atoms[ATOM_CLIPBOARD], { selection_source_t::from_span( atoms[ATOM_UTF8_STRING], payload ) } );
+
+    Events events;
+    size_t received = 0;
+    std::optional<selection_status> status;
+    const auto heap_before = heap_allocations.load();
+    const auto start       = clock::now();
+    requestor.RequestSelection( atoms[ATOM_CLIPBOARD], atoms[ATOM_UTF8_STRING], [&]( std::span<const std::byte> data, xcb_atom_t, selection_status state )
+    {
+        received += data.size();
+        if( state != SELECTION_DATA ) status = state;
+    });
+
+    const auto deadline = start + std::chrono::seconds( 30 );
+    while( !status && clock::now() < deadline )
+    {
+        owner.PollEvents( events );
+        events.clear();
+        requestor.WaitEvents( events, std::chrono::milliseconds( 1 ) );
+        events.clear();
+    }
+    const auto seconds = std::chrono::duration<double>( clock::now() - start ).count();
+
+    LOG_IF_F( WARNING, status != SELECTION_DONE || received != bytes, "selection: received %zu of %zu bytes", received, bytes );
+    std::printf( "{\"bench\":\"selection_incr\",\"bytes\":%zu,\"seconds\":%.6f,\"mb_per_sec\":%.1f,\"allocations\":%llu}\n",
+                 received, seconds, received / seconds / ( 1024.0 * 1024.0 ), static_cast<unsigned long long>( heap_allocations.load() - heap_before ) );
+    owner.ClearSelection( atoms[ATOM_CLIPBOARD] );
+}
+
+int run( uint64_t count )
+{
+    xvfb_t xvfb;
+
+    //-------------------------------------------------------------------------------------------//
+    //                                   WINDOW CREATION                                         //
+    //-------------------------------------------------------------------------------------------//
+    WindowProperties props;
+    props.display = xvfb.display;
+    props.width   = 640;
+    props.height  = 480;
+
+    const auto create = [&]( const char* name )
+    {
+        const auto trips_before = XCBWindow::RoundTrips();
+        const auto start        = clock::now();
+        auto window             = createWindow( props );
+        const auto seconds      = std::chrono::duration<double>( clock::now() - start ).count();
+        std::printf( "{\"bench\":\"%s\",\"round_trips\":%llu,\"seconds\":%.6f}\n", name,
+                     static_cast<unsigned long long>( XCBWindow::RoundTrips() - trips_before ), seconds );
+        return window;
+    };
+
+    // the second window shares the first one's connection and atom cache
+    auto window_ref = create( "create_first_window" );
+    auto shared_ref = create( "create_shared_window" );
+
+    //-------------------------------------------------------------------------------------------//
+    //                                   INPUT STORMS                                            //
+    //-------------------------------------------------------------------------------------------//
+    auto& window = *static_cast<XCBWindow*>( window_ref.get() );
+
+    auto injector = xcb_connect( xvfb.display.c_str(), nullptr );
+    if( xcb_connection_has_error( injector ) ) ABORT_F( "Failed to connect injector to %s", xvfb.display.c_str() );
+    const auto root   = xcb_setup_roots_iterator( xcb_get_setup( injector ) ).data->root;
+    const auto target = window.NativeWindow();
+
+    // wait for the window to become viewable before focusing it and moving the pointer over it
+    {
+        Events events;
+        const auto deadline = clock::now() + std::chrono::seconds( 5 );
+        bool exposed = false;
+        while( !exposed && clock::now() < deadline )
+        {
+            window.WaitEvents( events, std::chrono::milliseconds( 100 ) );
+            for( auto& event : events ) exposed |= dynamic_cast<WindowExposeEvent*>( event.get() ) != nullptr;
+            events.clear();
+        }
+    }
+    xcb_set_input_focus( injector, XCB_INPUT_FOCUS_POINTER_ROOT, target, XCB_CURRENT_TIME );
+    xcb_test_fake_input( injector, XCB_MOTION_NOTIFY, 0, XCB_CURRENT_TIME, root, 320, 240, 0 );
+    sync( injector );
+    {
+        Events events;
+        while( window.WaitEvents( events, std::chrono::milliseconds( 50 ) ) ) events.clear();
+    }
+
+    const auto any_event = []( Event* ) { return 1; };
+    const xcb_keycode_t keycode = 38;
+
+    report( run_storm( "key_storm", window, injector, count, [&]( uint64_t n )
+    {
+        for( uint64_t i = 0; i < n / 2; ++i )
+        {
+            xcb_test_fake_input( injector, XCB_KEY_PRESS, keycode, XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0 );
+            xcb_test_fake_input( injector, XCB_KEY_RELEASE, keycode, XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0 );
+        }
+    }, any_event ) );
+
+    report( run_storm( "button_storm", window, injector, count, [&]( uint64_t n )
+    {
+        for( uint64_t i = 0; i < n / 2; ++i )
+        {
+            xcb_test_fake_input( injector, XCB_BUTTON_PRESS, 1, XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0 );
+            xcb_test_fake_input( injector, XCB_BUTTON_RELEASE, 1, XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0 );
+        }
+    }, any_event ) );
+
+    report( run_storm( "motion_storm", window, injector, count, [&]( uint64_t n )
+    {
+        for( uint64_t i = 0; i < n; ++i )
+        {
+            xcb_test_fake_input( injector, XCB_MOTION_NOTIFY, 0, XCB_CURRENT_TIME, root, 100 + i % 400, 100 + ( i / 400 ) % 300, 0 );
+        }
+    }, any_event ) );
+
+    // configure notifies collapse to one event per poll, so count the notifies the server sent
+    // and finish once the final size has been reported; it alternates so every pass ends on a change
+    uint16_t final_width = 600;
+    uint64_t configures = 0;
+    const auto final_size = [&]( Event* event )
+    {
+        auto configure = dynamic_cast<WindowConfigureEvent*>( event );
+        return configure && configure->width == final_width ? configures : 0;
+    };
+    report( run_storm( "configure_storm", window, injector, count, [&]( uint64_t n )
+    {
+        configures  = n;
+        final_width = final_width == 600 ? 601 : 600;
+        for( uint64_t i = 0; i < n; ++i )
+        {
+            const uint32_t size[] = { i + 1 == n ? final_width : 300u + static_cast<uint32_t>( i % 200 ), 400 };
+            xcb_configure_window( injector, target, XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT, size );
+        }
+    }, final_size ) );
+
+    run_present( window, count / 20 );
+    run_selection( *static_cast<XCBWindow*>( shared_ref.get() ), window, 16 * 1024 * 1024 );
+
+    xcb_disconnect( injector );
+    return 0;
+}
+
+} // namespace aer::bench
+
+int main( int argc, char** argv )
+{
+    // the key and button storms inject press/release pairs, so an odd count could never be delivered in full
+    const uint64_t count = argc > 1 ? std::strtoull( argv[1], nullptr, 10 ) : 20000;
+    return aer::bench::run( ( count + 1 ) & ~uint64_t{ 1 } );
+}
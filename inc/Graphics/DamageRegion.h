@@ -0,0 +1,56 @@
+#pragma once
+
+#include <Base/Base.h>
+#include <Events/WindowEvents.h>
+
+#include <span>
+#include <vector>
+
+namespace aer
+{
+
+struct framebuffer_rect_t
+{
+    int32_t  x{};
+    int32_t  y{};
+    uint32_t width{};
+    uint32_t height{};
+};
+
+// the smallest rect containing all of rects
+framebuffer_rect_t bounding_rect( std::span<const framebuffer_rect_t> rects );
+
+// a union of rectangles kept short for repainting: a rect that costs no more area as part of a
+// neighbour's bounding box is folded into it, and past max_rects the cheapest pair is merged.
+// The result may overlap and may cover a little more than was added, never less
+class damage_region
+{
+public:
+    static constexpr size_t max_rects = 16;
+
+    void            add( const framebuffer_rect_t& rect );
+    // drops everything outside [0, width) x [0, height)
+    void            clip( uint32_t width, uint32_t height );
+    void            clear() { _rects.clear(); }
+
+    bool            empty() const { return _rects.empty(); }
+    auto            rects() const { return std::span<const framebuffer_rect_t>( _rects ); }
+    uint64_t        area() const;
+    framebuffer_rect_t bounds() const { return bounding_rect( _rects ); }
+protected:
+    std::vector<framebuffer_rect_t> _rects;
+};
+
+// the window needs repainting within rects, which are in window coordinates and already merged;
+// delivered once per run of server exposes instead of once per rectangle
+struct WindowDamageEvent : WindowExposeEvent
+{
+    std::vector<framebuffer_rect_t> rects;
+
+    WindowDamageEvent( Window* window, std::span<const framebuffer_rect_t> in_rects )
+    :   WindowExposeEvent( window ),
+        rects( in_rects.begin(), in_rects.end() )
+    {}
+};
+
+} // namespace aer
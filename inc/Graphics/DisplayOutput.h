@@ -0,0 +1,38 @@
+#pragma once
+
+#include <Events/WindowEvents.h>
+
+#include <cstdint>
+#include <string>
+
+namespace aer
+{
+
+// a lit monitor output and the part of the screen it shows
+struct display_output_t
+{
+    std::string name;               // as the server names the connector, e.g. "DP-1"
+    int32_t     x{};
+    int32_t     y{};
+    uint32_t    width{};
+    uint32_t    height{};
+    uint32_t    refresh_mhz{};      // refresh rate of the current mode in millihertz, 0 when unknown
+    bool        primary = false;
+
+    double      refresh_rate() const { return refresh_mhz / 1000.0; }
+
+    bool operator==( const display_output_t& ) const = default;
+};
+
+// the window went fullscreen on output, or the output it covers changed mode or position
+struct WindowOutputEvent : WindowEvent
+{
+    display_output_t output;
+
+    WindowOutputEvent( Window* window, const display_output_t& in_output )
+    :   WindowEvent( window ),
+        output( in_output )
+    {}
+};
+
+} // namespace aer
@@ -0,0 +1,399 @@
+#pragma once
+
+#include <Base/Base.h>
+#include <Graphics/XCBRandR.h>
+#include <Graphics/XCBXInput.h>
+#include <Input/EventRing.h>
+#include <Input/KeyCodes.h>
+#include <Input/KeyboardMap.h>
+
+#include <xcb/xcb.h>
+#include <xcb/xcbext.h>
+#include <xcb/present.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace aer::xcb
+{
+
+enum : uint8_t { SERVER_USER_MASK = 0x80 };
+
+enum atom_size : uint8_t
+{
+    ATOM_SIZE_8     = 8,
+    ATOM_SIZE_16    = 16,
+    ATOM_SIZE_32    = 32
+};
+
+inline std::atomic<uint64_t> round_trip_count{ 0 };
+
+// collects a reply, counting a round-trip only when it has to block for it; replies to
+// requests that went out in the same flush as an earlier waited-for one are already queued
+template<typename Reply>
+Reply* wait_for_reply( xcb_connection_t* connection, unsigned int sequence )
+{
+    void* reply = nullptr;
+    xcb_generic_error_t* error = nullptr;
+    if( !xcb_poll_for_reply( connection, sequence, &reply, &error ) )
+    {
+        round_trip_count.fetch_add( 1, std::memory_order_relaxed );
+        reply = xcb_wait_for_reply( connection, sequence, &error );
+    }
+    free( error );
+    return static_cast<Reply*>( reply );
+}
+
+struct atom_request_t
+{
+    xcb_connection_t*        _connection = nullptr;
+    xcb_intern_atom_cookie_t _cookie{};
+    xcb_atom_t               _atom{};
+    
+    atom_request_t( xcb_connection_t* in_connection, const char* atom_name )
+    :   _connection( in_connection ), 
+        _cookie( xcb_intern_atom( _connection, false, strlen( atom_name ), atom_name ) )
+    {}
+
+    operator xcb_atom_t()
+    {
+        if( _connection )
+        {
+            if( auto reply = wait_for_reply<xcb_intern_atom_reply_t>( _connection, _cookie.sequence ) )
+            {
+                _atom = reply->atom;
+                free( reply );
+            } 
+            _connection = nullptr;
+        }
+        return _atom;
+    }
+};
+
+enum atom_id : uint8_t
+{
+    ATOM_WM_PROTOCOLS,
+    ATOM_WM_DELETE_WINDOW,
+    ATOM_MOTIF_WM_HINTS,
+    ATOM_NET_WM_STATE,
+    ATOM_NET_WM_STATE_FULLSCREEN,
+    ATOM_NET_WM_BYPASS_COMPOSITOR,
+    ATOM_CLIPBOARD,
+    ATOM_TARGETS,
+    ATOM_INCR,
+    ATOM_UTF8_STRING,
+    ATOM_AER_SELECTION,
+    ATOM_COUNT
+};
+
+// interns every well-known atom in one pipelined batch; the first lookup collects all replies
+struct atom_cache : Object
+{
+    static constexpr std::array<const char*, ATOM_COUNT> names
+    {
+        "WM_PROTOCOLS",
+        "WM_DELETE_WINDOW",
+        "_MOTIF_WM_HINTS",
+        "_NET_WM_STATE",
+        "_NET_WM_STATE_FULLSCREEN",
+        "_NET_WM_BYPASS_COMPOSITOR",
+        "CLIPBOARD",
+        "TARGETS",
+        "INCR",
+        "UTF8_STRING",
+        "AER_SELECTION"
+    };
+
+    atom_cache( xcb_connection_t* connection )
+    :   _connection( connection )
+    {
+        for( size_t i = 0; i < ATOM_COUNT; ++i )
+        {
+            _cookies[i] = xcb_intern_atom( _connection, false, strlen( names[i] ), names[i] );
+        }
+    }
+
+    xcb_atom_t operator[]( atom_id id )
+    {
+        if( _connection )
+        {
+            for( size_t i = 0; i < ATOM_COUNT; ++i )
+            {
+                if( auto reply = wait_for_reply<xcb_intern_atom_reply_t>( _connection, _cookies[i].sequence ) )
+                {
+                    _atoms[i] = reply->atom;
+                    free( reply );
+                }
+            }
+            _connection = nullptr;
+        }
+        return _atoms[id];
+    }
+
+protected:
+    xcb_connection_t*                                   _connection = nullptr;
+    std::array<xcb_intern_atom_cookie_t, ATOM_COUNT>    _cookies{};
+    std::array<xcb_atom_t, ATOM_COUNT>                  _atoms{};
+};
+
+// the server's keyboard mapping, requested at startup and again whenever it changes
+struct keyboard_map : keycode_map, Object
+{
+    // only sends the request so it can share a flush with other startup requests; call update()
+    keyboard_map( xcb_connection_t* connection )
+    :   _connection( connection )
+    {
+        auto setup = xcb_get_setup( _connection );
+        request( setup->min_keycode, setup->max_keycode - setup->min_keycode + 1 );
+    }
+
+    // a fixed table, for Offline connections
+    keyboard_map( const code_map& codes )
+    :   keycode_map( codes )
+    {}
+
+    // rebuild the rows for [first_keycode, first_keycode + count), as reported by XCB_MAPPING_NOTIFY.
+    // Only the request goes out; poll() picks the reply up, and keys translate with the old rows
+    // until then
+    void refresh( xcb_keycode_t first_keycode, uint8_t count )
+    {
+        if( _pending )
+        {
+            // one request for both ranges replaces the one still in flight
+            const int end = std::max( first_keycode + count, _pending_first + _pending_count );
+            first_keycode = std::min( first_keycode, _pending_first );
+            count         = static_cast<uint8_t>( end - first_keycode );
+            xcb_discard_reply( _connection, _pending->sequence );
+        }
+        request( first_keycode, count );
+        xcb_flush( _connection );
+    }
+
+    void request( xcb_keycode_t first_keycode, uint8_t count )
+    {
+        _pending = xcb_get_keyboard_mapping( _connection, first_keycode, count );
+        _pending_first = first_keycode;
+        _pending_count = count;
+    }
+
+    // blocks until the requested rows have arrived
+    void update()
+    {
+        if( !_pending ) return;
+        const auto cookie = *std::exchange( _pending, std::nullopt );
+        if( auto reply = wait_for_reply<xcb_get_keyboard_mapping_reply_t>( _connection, cookie.sequence ) ) apply( reply );
+    }
+
+    // takes the requested rows in if their reply has arrived, without waiting for it
+    void poll()
+    {
+        if( !_pending ) return;
+        void* reply = nullptr;
+        xcb_generic_error_t* error = nullptr;
+        if( !xcb_poll_for_reply( _connection, _pending->sequence, &reply, &error ) ) return;
+        _pending.reset();
+        free( error );
+        if( reply ) apply( static_cast<xcb_get_keyboard_mapping_reply_t*>( reply ) );
+    }
+
+protected:
+    // frees the reply
+    void apply( xcb_get_keyboard_mapping_reply_t* reply )
+    {
+        auto keysyms = xcb_get_keyboard_mapping_keysyms( reply );
+        auto length = xcb_get_keyboard_mapping_keysyms_length( reply );
+        auto keysyms_per_keycode = reply->keysyms_per_keycode;
+        auto levels = std::min<size_t>( keysyms_per_keycode, num_levels );
+
+        for( int i = 0; keysyms_per_keycode && i < length; i += keysyms_per_keycode )
+        {
+            auto keysym = &keysyms[i];
+            auto& row = _keymap[( _pending_first + i / keysyms_per_keycode ) & 0xFF];
+            row.fill( KEY_Undefined );
+            for( size_t j = 0; j < levels; ++j ) row[j] = keysym[j];
+        }
+        free( reply );
+    }
+
+    xcb_connection_t* _connection = nullptr;
+    std::optional<xcb_get_keyboard_mapping_cookie_t> _pending;
+    xcb_keycode_t _pending_first{};
+    uint8_t _pending_count{};
+    uint16_t _modmask{ 0XFF };
+};
+
+// maps wrapping millisecond server timestamps onto the local steady clock. A server on this
+// machine stamps events with CLOCK_MONOTONIC, which is steady_clock itself, so only the wraps
+// need restoring. For a remote one the offset follows the lower envelope of (receipt - server
+// time), i.e. the least delayed event seen so far, and may creep upwards by drift_ppm so it keeps
+// tracking a server clock running at another rate
+struct server_clock
+{
+    using clock = std::chrono::steady_clock;
+    static constexpr double drift_ppm = 500.0;
+    // a server time further than this from the receipt time cannot be on our clock
+    static constexpr auto same_clock_tolerance = std::chrono::seconds( 1 );
+
+    clock::time_point convert( xcb_timestamp_t server_time, clock::time_point received )
+    {
+        if( !_synced )
+        {
+            // start from the extension of server_time nearest the local clock, exact on a local server
+            const int64_t local  = std::chrono::duration_cast<std::chrono::milliseconds>( received.time_since_epoch() ).count();
+            const int32_t behind = static_cast<int32_t>( static_cast<xcb_timestamp_t>( local ) - server_time );
+            _same_clock = std::chrono::milliseconds( std::abs( int64_t{ behind } ) ) < same_clock_tolerance;
+            _extended   = local - behind;
+            _last       = server_time;
+        }
+        const int64_t extended = _extended + static_cast<int32_t>( server_time - _last );
+        const auto server      = clock::time_point( std::chrono::milliseconds( extended ) );
+        const auto observed    = received - server;
+
+        if( _same_clock ) _offset = clock::duration::zero();
+        else if( !_synced ) _offset = observed;
+        else
+        {
+            const auto allowance = std::chrono::duration_cast<clock::duration>( ( received - _updated ) * ( drift_ppm / 1e6 ) );
+            _offset = std::min( _offset + allowance, observed );
+        }
+        _synced   = true;
+        _last     = server_time;
+        _extended = extended;
+        _updated  = received;
+        return std::min( server + _offset, received );
+    }
+
+    // the local time of a server timestamp under the current estimate, without refining it
+    clock::time_point to_local( xcb_timestamp_t server_time ) const
+    {
+        const int64_t extended = _extended + static_cast<int32_t>( server_time - _last );
+        return clock::time_point( std::chrono::milliseconds( extended ) ) + _offset;
+    }
+
+    bool synced() const { return _synced; }
+    bool same_clock() const { return _same_clock; }
+protected:
+    bool                _synced = false;
+    bool                _same_clock = false;
+    xcb_timestamp_t     _last{};
+    int64_t             _extended{};
+    clock::duration     _offset{};
+    clock::time_point   _updated{};
+};
+
+struct queued_event_t
+{
+    xcb_generic_event_t*                    event = nullptr;
+    std::chrono::steady_clock::time_point   received{};     // when it left libxcb's queue
+};
+
+// the window an event is addressed to, or 0 for connection-wide events; generic events are
+// only understood for the extension with the given opcode
+xcb_window_t event_window( const xcb_generic_event_t* event, uint8_t xinput_opcode = 0 );
+// the server time an event carries, if its type has one
+std::optional<xcb_timestamp_t> event_timestamp( const xcb_generic_event_t* event, uint8_t xinput_opcode = 0 );
+
+} // namespace aer::xcb
+
+namespace aer
+{
+
+// one X connection shared by every window on the same display; events are read once and
+// routed into per-window queues by the window they target. Windows sharing a connection
+// must be polled from a single thread. XInput, Present and RandR are set up on first use,
+// which blocks on the server.
+class XCBConnection : public Object
+{
+public:
+    using event_queue = std::vector<xcb::queued_event_t>;
+
+    // the live connection to display_name, opened on first use and kept open until exit, so
+    // every holder of a display shares one connection however windows come and go; screen_num
+    // receives the screen named by the display string
+    static ref_ptr<XCBConnection> Open( const std::string& display_name, int* screen_num = nullptr );
+    // wraps a caller-owned connection, which is never disconnected here
+    static ref_ptr<XCBConnection> Adopt( xcb_connection_t* connection );
+    // no server behind it, only a keymap, XInput state and server clock for translating
+    // recorded events; Native() is null and Dispatch never produces anything
+    static ref_ptr<XCBConnection> Offline( const xcb::keyboard_map::code_map& keymap, ref_ptr<xcb::xinput> xinput = {} );
+
+    xcb_connection_t*   Native() const  { return _connection; }
+    const xcb_setup_t*  Setup() const   { return _setup; }
+    xcb_screen_t*       Screen( int screen_num ) const;
+    xcb::atom_cache&    Atoms()         { return *_atoms.get(); }
+    xcb::keyboard_map&  Keymap()        { return *_keymap.get(); }
+    xcb::server_clock&  ServerClock()   { return _server_clock; }
+    xcb::xinput&        XInput();
+    // 0 until XInput has been set up, or when the server lacks XInput 2.1
+    uint8_t             XInputOpcode() const { return _xinput ? _xinput->opcode : 0; }
+    // whether the server has Present 1.0
+    bool                HasPresent();
+    // 0 until Present has been set up, or when the server lacks it
+    uint8_t             PresentOpcode() const { return _present_opcode; }
+    // the outputs of the default screen
+    xcb::randr&         RandR();
+    // raw pointer events are only delivered to the root, so they go to the one window that
+    // asked for them last; disabling only stops them if that is still this window
+    void                SetRawInput( xcb_window_t window, bool enable );
+
+    event_queue&        Register( xcb_window_t window );
+    void                Unregister( xcb_window_t window );
+    // also routes property changes on window to watcher, selecting them first when window
+    // belongs to another client; used to serve a selection to it in increments
+    void                WatchProperties( xcb_window_t window, xcb_window_t watcher, bool enable );
+
+    // moves every available event into the queue of the window it targets
+    void                Dispatch();
+
+    // drain the connection on a background thread; Dispatch then only empties the handoff ring
+    void                SetThreadedInput( bool enable );
+    // readable whenever Dispatch has input to route; it changes when threaded input is toggled
+    int                 FileDescriptor() const;
+    // input already buffered in user space, which will not make FileDescriptor readable
+    bool                HasPendingEvents();
+protected:
+                        XCBConnection( xcb_connection_t* connection, std::string display_name, bool owned );
+                        XCBConnection( const xcb::keyboard_map::code_map& keymap, ref_ptr<xcb::xinput> xinput );
+    virtual             ~XCBConnection();
+
+    void                Route( const xcb::queued_event_t& queued );
+    void                ReaderLoop( std::stop_token stop );
+protected:
+    xcb_connection_t*               _connection = nullptr;
+    const xcb_setup_t*              _setup      = nullptr;
+    std::string                     _display_name;
+    bool                            _owned      = true;
+    int                             _default_screen = 0;
+    ref_ptr<xcb::atom_cache>        _atoms;
+    ref_ptr<xcb::keyboard_map>      _keymap;
+    xcb::server_clock               _server_clock;
+    ref_ptr<xcb::xinput>            _xinput;
+    xcb_window_t                    _raw_input_window{};
+    std::optional<bool>             _present;
+    uint8_t                         _present_opcode = 0;
+    ref_ptr<xcb::randr>             _randr;
+
+    std::unordered_map<xcb_window_t, event_queue> _queues;
+    std::unordered_map<xcb_window_t, std::vector<xcb_window_t>> _property_watchers;
+
+    static constexpr size_t reader_ring_size = 4096;
+    event_ring<xcb::queued_event_t, reader_ring_size>  _reader_ring;
+    std::atomic<bool>                                   _reader_waiting{ false };
+    int                                                 _reader_wake = -1;
+    xcb_window_t                                        _wake_window{};
+    xcb_generic_event_t*                                _queued_event = nullptr;
+    xcb::queued_event_t                                 _reader_leftover;   // read while stopping with the ring full
+    std::jthread                                        _reader;
+};
+
+} // namespace aer
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <Base/Base.h>
+
+#include <chrono>
+#include <optional>
+
+namespace aer::xcb
+{
+
+struct frame_target_t
+{
+    uint64_t                                msc{};      // the vblank counter value to be shown at
+    std::chrono::steady_clock::time_point   vblank{};   // predicted time of that vblank
+    std::chrono::steady_clock::time_point   start{};    // when rendering has to start to make it
+};
+
+// predicts vblanks from the (UST, MSC) pairs of Present CompleteNotify events. UST is the
+// server's CLOCK_MONOTONIC in microseconds, which is steady_clock itself when the server runs
+// on this machine; a remote one gets an offset that follows the least delayed notify seen
+class frame_scheduler
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    // the vblank numbered msc happened at ust
+    void            vblank( uint64_t ust, uint64_t msc, clock::time_point received );
+    // the server skipped a presented pixmap, which never reached the screen
+    void            skipped() { ++_missed; }
+    // a presented pixmap can be reused
+    void            idle( uint32_t serial ) { _idle_serial = serial; }
+
+    // two vblanks have been seen, so the refresh interval is known
+    bool            calibrated() const { return _period.has_value(); }
+    clock::duration refresh_interval() const { return _period.value_or( clock::duration::zero() ); }
+    std::optional<uint64_t> last_msc() const { return _anchor_msc; }
+    clock::time_point predict( uint64_t msc ) const;
+
+    // the first vblank that leaves budget for rendering from now on; before calibration
+    // the target is now, so rendering starts immediately
+    frame_target_t  next_frame( clock::time_point now, clock::duration budget ) const;
+    // the frame aimed at target was submitted at now; returns the vblanks it missed
+    uint64_t        frame_done( const frame_target_t& target, clock::time_point now );
+
+    uint64_t        frames() const          { return _frames; }
+    uint64_t        missed_frames() const   { return _missed; }
+    uint32_t        idle_serial() const     { return _idle_serial; }
+    void            reset_stats()           { _frames = _missed = 0; }
+protected:
+    clock::time_point to_local( uint64_t ust, clock::time_point received );
+
+    std::optional<uint64_t>         _anchor_msc;
+    clock::time_point               _anchor_time{};
+    std::optional<clock::duration>  _period;
+    std::optional<clock::duration>  _ust_offset;
+    uint32_t                        _outliers = 0;      // intervals in a row far off the estimate
+    uint64_t                        _frames = 0;
+    uint64_t                        _missed = 0;
+    uint32_t                        _idle_serial = 0;
+};
+
+} // namespace aer::xcb
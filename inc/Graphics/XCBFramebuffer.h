@@ -0,0 +1,66 @@
+#pragma once
+
+#include <Base/Base.h>
+#include <Graphics/DamageRegion.h>
+#include <Graphics/XCBConnection.h>
+
+#include <xcb/xcb.h>
+#include <xcb/shm.h>
+
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace aer
+{
+
+// a CPU-side 32 bit-per-pixel image in the window's visual format. It lives in an MIT-SHM
+// segment the server reads directly when the extension is usable, and otherwise in local
+// memory that is uploaded with xcb_put_image in chunks under the maximum request length
+class XCBFramebuffer : public Object
+{
+public:
+                    XCBFramebuffer( ref_ptr<XCBConnection> display, xcb_drawable_t drawable, uint8_t depth,
+                                    uint32_t width, uint32_t height, bool allow_shm = true );
+
+    // waits until the server has finished reading the previous Present before handing out the pixels
+    std::span<uint32_t> Pixels();
+    uint32_t        Stride() const  { return _width; }      // in pixels
+    uint32_t        Width() const   { return _width; }
+    uint32_t        Height() const  { return _height; }
+    bool            Shared() const  { return _segment != 0; }
+
+    // reallocates the image; its contents are undefined afterwards
+    void            Resize( uint32_t width, uint32_t height );
+    // uploads the dirty rectangles, clipped to the image, or the whole image when none are given
+    void            Present( std::span<const framebuffer_rect_t> dirty = {} );
+protected:
+    virtual         ~XCBFramebuffer();
+
+    void            Allocate();
+    void            Release();
+    void            PutImage( const framebuffer_rect_t& rect );
+    void            WaitIdle();
+protected:
+    ref_ptr<XCBConnection>  _display;
+    xcb_connection_t*       _connection = nullptr;
+    xcb_drawable_t          _drawable{};
+    xcb_gcontext_t          _gc{};
+    uint8_t                 _depth{};
+    uint32_t                _width{};
+    uint32_t                _height{};
+    bool                    _allow_shm = true;
+
+    // shared memory path
+    xcb_shm_seg_t           _segment{};
+    uint32_t*               _shared = nullptr;
+    // a request queued behind the last shm upload; its reply means the server is done reading
+    std::optional<xcb_get_input_focus_cookie_t> _fence;
+
+    // socket path
+    std::vector<uint32_t>   _local;
+    std::vector<uint32_t>   _scratch;
+    size_t                  _max_request_bytes = 0;
+};
+
+} // namespace aer
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Base/Base.h>
+#include <Graphics/DisplayOutput.h>
+
+#include <xcb/xcb.h>
+#include <xcb/randr.h>
+
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace aer::xcb
+{
+
+struct output_t : display_output_t
+{
+    xcb_randr_output_t  id{};
+    xcb_randr_crtc_t    crtc{};
+};
+
+// the outputs of one screen through RandR 1.3+. Querying them costs round-trips, so the list is
+// only built on first use and again after the server announces a change of configuration
+struct randr : Object
+{
+    // queries the extension and selects screen change notifies on root; first_event stays 0
+    // when RandR 1.3 is missing
+    randr( xcb_connection_t* connection, xcb_window_t root );
+
+    bool                available() const { return first_event != 0; }
+    // the configuration changed; the next look at the outputs queries them again
+    void                invalidate() { _stale = true; ++_changes; }
+    // counts invalidations, so a window can tell whether its output needs another look
+    uint32_t            changes() const { return _changes; }
+
+    // every lit output, primary first
+    std::span<const output_t> outputs();
+    // the output called name, or the primary one for an empty name; null when none is lit
+    const output_t*     find( std::string_view name );
+
+    uint8_t             first_event = 0;
+protected:
+    void                refresh();
+
+    xcb_connection_t*       _connection = nullptr;
+    xcb_window_t            _root{};
+    std::vector<output_t>   _outputs;
+    bool                    _stale = true;
+    uint32_t                _changes = 0;
+};
+
+} // namespace aer::xcb
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <Graphics/XCBTrace.h>
+#include <Graphics/XCBWindow.h>
+
+namespace aer
+{
+
+// plays back a trace recorded with XCBWindow::StartTrace through the same translation code,
+// with no X server. Each PollEvents translates one recorded batch, so a replay produces the
+// same events in the same PollEvents calls as the recorded session.
+class XCBReplayWindow : public XCBWindow
+{
+    using clock = std::chrono::steady_clock;
+public:
+    enum class pacing : uint8_t
+    {
+        FAST,           // every batch as soon as it is polled
+        REAL_TIME       // PollEvents sleeps until the batch's recorded offset from the start
+    };
+
+                    XCBReplayWindow( const std::string& path, pacing mode = pacing::FAST, const WindowProperties& = WindowProperties() );
+    using XCBWindow::PollEvents;
+    bool            PollEvents( Events& events_list, bool clear_unhandled = true ) override;
+
+    // every recorded batch has been delivered
+    bool            Finished() const { return !_trace_reader->peek().has_value(); }
+    // restart from the first batch; event times restart from the next poll
+    void            Rewind();
+protected:
+                    XCBReplayWindow( ref_ptr<xcb::trace_reader> trace, pacing mode, const WindowProperties& props );
+    virtual         ~XCBReplayWindow() = default;
+protected:
+    ref_ptr<xcb::trace_reader>      _trace_reader;
+    pacing                          _pacing;
+    std::optional<clock::duration>  _offset;        // replay time minus recorded time
+};
+
+} // namespace aer
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <Base/Base.h>
+#include <Graphics/XCBConnection.h>
+
+#include <xcb/xcb.h>
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace aer
+{
+
+// one target of a selection being served. read returns up to max bytes starting at offset, in a
+// span that stays valid until the next call; an empty span ends the data
+struct selection_source_t
+{
+    xcb_atom_t  target{};
+    xcb_atom_t  type{};         // property type announced to the requestor, usually target itself
+    size_t      size{};         // total bytes; only decides whether the transfer goes incrementally
+    std::function<std::span<const std::byte>( size_t offset, size_t max )> read;
+
+    // serves a caller-owned buffer, which has to outlive the ownership and any transfer in flight
+    static selection_source_t from_span( xcb_atom_t target, std::span<const std::byte> data, xcb_atom_t type = XCB_NONE );
+};
+
+enum selection_status : uint8_t
+{
+    SELECTION_DATA,             // another chunk, in order
+    SELECTION_DONE,             // everything has been delivered
+    SELECTION_FAILED            // refused by the owner, no owner, or the transfer stalled
+};
+
+// receives a fetched selection chunk by chunk; data points into a reply and is only valid during the call
+using selection_sink = std::function<void( std::span<const std::byte> data, xcb_atom_t type, selection_status status )>;
+
+// ICCCM selections for one window, served from and fetched into caller code in chunks. Anything
+// larger than one request goes through INCR, so no side ever holds the whole payload and
+// nothing waits on the server: replies are collected by Update during later polls.
+class XCBSelection : public Object
+{
+    using clock = std::chrono::steady_clock;
+public:
+                    XCBSelection( ref_ptr<XCBConnection> display, xcb_window_t window );
+
+    // time should be the server time of the event that caused the change. Ownership is not
+    // confirmed with the server, which would cost a round-trip; losing it arrives as a clear
+    void            Own( xcb_atom_t selection, std::vector<selection_source_t> sources, xcb_timestamp_t time );
+    void            Disown( xcb_atom_t selection, xcb_timestamp_t time );
+    bool            Owns( xcb_atom_t selection ) const { return _owned.contains( selection ); }
+
+    // queues a request for target from the owner of selection; it is sent by the next Update,
+    // once the window selects property changes, and after any fetch already in progress
+    void            Fetch( xcb_atom_t selection, xcb_atom_t target, selection_sink sink, xcb_timestamp_t time );
+    // the window has to select property changes while this holds
+    bool            Fetching() const { return _fetch.has_value() || !_pending.empty(); }
+    size_t          Serving() const { return _transfers.size(); }
+
+    // selection requests, notifies and clears, and property changes; false for anything else
+    bool            HandleEvent( const xcb_generic_event_t* event );
+    // starts queued fetches, collects property replies and gives up on stalled transfers
+    void            Update( clock::time_point now );
+protected:
+    virtual         ~XCBSelection();
+
+    struct owned_t
+    {
+        std::vector<selection_source_t> sources;
+        xcb_timestamp_t                 time{};
+    };
+
+    // an INCR transfer to a requestor, advanced by each deletion of its property
+    struct transfer_t
+    {
+        xcb_window_t        requestor{};
+        xcb_atom_t          property{};
+        selection_source_t  source;
+        size_t              offset{};
+        clock::time_point   active{};
+    };
+
+    struct fetch_t
+    {
+        xcb_atom_t          selection{};
+        xcb_atom_t          target{};
+        selection_sink      sink;
+        xcb_timestamp_t     time{};
+        bool                converted = false;      // the owner has answered the conversion
+        bool                incremental = false;
+        uint32_t            offset{};               // next read position in 32-bit units
+        size_t              received{};             // bytes in the current property so far
+        std::optional<xcb_get_property_cookie_t> reply;
+        bool                new_value = false;      // the next chunk arrived while reading this one
+        clock::time_point   active{};
+    };
+
+    size_t          ChunkBytes();
+    void            Serve( const xcb_selection_request_event_t* request );
+    void            WriteProperty( xcb_window_t requestor, xcb_atom_t property, const selection_source_t& source );
+    void            PropertyDeleted( const xcb_property_notify_event_t* notify );
+    void            StartFetch();
+    void            ReadProperty();
+    void            PropertyRead( xcb_get_property_reply_t* reply );
+    void            FinishFetch( selection_status status );
+protected:
+    ref_ptr<XCBConnection>          _display;
+    xcb_connection_t*               _connection = nullptr;
+    xcb_window_t                    _window{};
+    xcb_atom_t                      _property{};
+    size_t                          _chunk_bytes{};     // largest property write, decided on first use
+
+    std::unordered_map<xcb_atom_t, owned_t> _owned;
+    std::vector<transfer_t>         _transfers;
+    std::optional<fetch_t>          _fetch;
+    std::deque<fetch_t>             _pending;
+};
+
+} // namespace aer
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <Base/Base.h>
+#include <Graphics/XCBConnection.h>
+
+#include <xcb/xcb.h>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace aer::xcb
+{
+
+// trace file layout, all native endian and 8 byte aligned so a mapped file can be read in place:
+//   trace_header_t
+//   per PollEvents: trace_batch_t, then count x ( trace_event_t, event bytes padded to 8 )
+struct trace_header_t
+{
+    static constexpr std::array<char, 8> expected_magic{ 'A', 'E', 'R', 'X', 'T', 'R', 'C', 0 };
+    static constexpr uint32_t            current_version = 3;
+
+    std::array<char, 8>     magic = expected_magic;
+    uint32_t                version = current_version;
+    uint32_t                symbol_size = sizeof( key::symbol );
+    xcb_window_t            window{};
+    xcb_window_t            root{};
+    xcb_window_t            parent{};   // frame-relative ConfigureNotify coordinates depend on it
+    xcb_atom_t              delete_protocol{};
+    int32_t                 x{};        // window geometry when recording starts
+    int32_t                 y{};
+    uint32_t                width{};
+    uint32_t                height{};
+    uint8_t                 xinput_opcode{};
+    uint8_t                 pointer_input{};
+    uint16_t                num_scroll_valuators{};
+    keyboard_map::code_map  keymap{};   // snapshot taken when recording starts
+    std::array<scroll_valuator_t, xinput::max_scroll_valuators> scroll_valuators{};
+};
+
+struct trace_batch_t
+{
+    int64_t  dispatched;                // steady clock nanoseconds
+    uint32_t count;
+    uint32_t reserved;
+};
+
+struct trace_event_t
+{
+    int64_t  received;                  // steady clock nanoseconds
+    uint32_t size;                      // event bytes, as laid out by libxcb
+    uint32_t reserved;
+};
+
+// bytes libxcb allocated for an event; generic events carry their payload after full_sequence
+size_t event_size( const xcb_generic_event_t* event );
+
+// appends batches to a trace file through a user-space buffer
+class trace_writer : public Object
+{
+public:
+                    trace_writer( const std::string& path, const trace_header_t& header );
+    bool            valid() const { return _fd >= 0; }
+    void            write( std::chrono::steady_clock::time_point dispatched, std::span<const queued_event_t> batch );
+    void            flush();
+protected:
+    virtual         ~trace_writer();
+    void            append( const void* data, size_t size );
+protected:
+    static constexpr size_t flush_threshold = 1 << 16;
+
+    int                     _fd = -1;
+    std::vector<std::byte>  _buffer;
+};
+
+// maps a trace file and walks it a batch at a time; events point into the mapping
+class trace_reader : public Object
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+                    trace_reader( const std::string& path );
+    bool            valid() const { return _header != nullptr; }
+    const trace_header_t& header() const { return *_header; }
+
+    // the dispatch time of the next batch, if any are left
+    std::optional<clock::time_point> peek() const;
+    // fills batch with the next recorded batch and returns its dispatch time
+    std::optional<clock::time_point> next( std::vector<queued_event_t>& batch );
+    void            rewind() { _cursor = sizeof( trace_header_t ); }
+protected:
+    virtual         ~trace_reader();
+protected:
+    const std::byte*        _data = nullptr;
+    size_t                  _size = 0;
+    size_t                  _cursor = 0;
+    const trace_header_t*   _header = nullptr;
+};
+
+} // namespace aer::xcb
@@ -2,28 +2,219 @@
 
 #include <Base/Base.h>
 #include <Base/Event.h>
+#include <Graphics/DamageRegion.h>
+#include <Graphics/DisplayOutput.h>
 #include <Graphics/Window.h>
+#include <Graphics/XCBConnection.h>
+#include <Graphics/XCBFrameScheduler.h>
+#include <Graphics/XCBFramebuffer.h>
+#include <Graphics/XCBSelection.h>
+#include <Graphics/XCBTrace.h>
+#include <Input/EventPool.h>
+#include <Input/EventTime.h>
+#include <Input/TypedEvents.h>
 
 #include <xcb/xcb.h>
 
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
 namespace aer
 {
+struct pointer_sample_t
+{
+    int16_t         x{};
+    int16_t         y{};
+    xcb_timestamp_t time{};         // server time
+    input_clock::time_point local_time{};
+    float           precise_x{};    // sub-pixel position under XInput2, otherwise x and y
+    float           precise_y{};
+};
+
+// relative motion or scrolling accumulated until the next flush
+struct pointer_delta_t
+{
+    double                  dx{};
+    double                  dy{};
+    int16_t                 x{};
+    int16_t                 y{};
+    input_clock::time_point time{};
+};
+
+enum pointer_input : uint8_t
+{
+    POINTER_CORE        = 0,
+    POINTER_RAW_MOTION  = 0b01,     // XI_RawMotion as MouseRawMotionEvent, delivered wherever the pointer is
+    POINTER_PRECISE     = 0b10      // XI_Motion: sub-pixel motion and MouseSmoothScrollEvent from scroll valuators
+};
+
+struct window_geometry_t
+{
+    int32_t  x{};
+    int32_t  y{};
+    uint32_t width{};
+    uint32_t height{};
+
+    bool operator==( const window_geometry_t& ) const = default;
+};
 
+// SetPointerInput, SetFramePacing and SetFullscreen set up the extension they need on first
+// call, which blocks on the server
 class XCBWindow : public Window
 {
     using clock = std::chrono::steady_clock;
 public:
                     XCBWindow( const WindowProperties& = WindowProperties() );
     bool            PollEvents( Events& events_list, bool clear_unhandled = true ) override;
+    // sleeps until input arrives or timeout expires, then polls; no timeout waits indefinitely
+    bool            WaitEvents( Events& events_list, std::optional<clock::duration> timeout = std::nullopt, bool clear_unhandled = true );
+    // the same events as plain records appended to per-category arrays, with no allocation
+    // once their capacity has grown; returns whether anything was appended
+    bool            PollEvents( typed_events_t& events );
+
+    // readable whenever the connection has input to route, for use with EventLoop::AddSource;
+    // it changes when threaded input is toggled
+    int             FileDescriptor() const;
+    // input already buffered in user space or routed to this window by another's poll,
+    // which will not make FileDescriptor readable
+    bool            HasPendingEvents();
+
+    xcb_window_t    NativeWindow() const { return _window; }
+    auto            Connection() const { return _display; }
+
+    // process-wide count of requests that had to block on a server reply
+    static uint64_t RoundTrips();
+
+    static constexpr uint32_t default_event_mask = XCB_EVENT_MASK_EXPOSURE | XCB_EVENT_MASK_STRUCTURE_NOTIFY
+                                                 | XCB_EVENT_MASK_FOCUS_CHANGE | XCB_EVENT_MASK_PROPERTY_CHANGE
+                                                 | XCB_EVENT_MASK_KEY_PRESS | XCB_EVENT_MASK_KEY_RELEASE
+                                                 | XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_BUTTON_RELEASE
+                                                 | XCB_EVENT_MASK_POINTER_MOTION;
+    // the core events selected on the window, a combination of xcb_event_mask_t. The server does
+    // not generate what is not selected, so dropping unused events saves wakeups and traffic;
+    // BUTTON_MOTION in place of POINTER_MOTION only reports drags. STRUCTURE_NOTIFY always
+    // stays selected since the window's geometry depends on it
+    void            SetEventMask( uint32_t mask );
+    uint32_t        EventMask() const { return _event_mask; }
+
+    // collapse runs of consecutive motion events into one MouseMoveEvent at the final position
+    void            SetMotionCoalescing( bool enable ) { _coalesce_motion = enable; }
+    // every pointer position received during the last PollEvents, in arrival order
+    auto            MotionHistory() const { return std::span<const pointer_sample_t>( _motion_history ); }
+    // event age histograms: server timestamp to leaving libxcb, and leaving libxcb to translation
+    const input_latency_t& InputLatency() const { return _latency; }
+    void            ResetInputLatency() { _latency = {}; }
+    // drain the shared connection on a background thread; see XCBConnection::SetThreadedInput
+    void            SetThreadedInput( bool enable );
+    // a combination of pointer_input flags; returns false when they need XInput 2.1 and the
+    // server lacks it
+    bool            SetPointerInput( uint8_t flags );
+
+    // a software framebuffer sized to the window, created on first use and resized to follow it
+    XCBFramebuffer& Framebuffer();
+
+    // follow the window's vblanks through Present CompleteNotify and IdleNotify; returns false
+    // when the server lacks Present
+    bool            SetFramePacing( bool enable );
+    // the next vblank that leaves budget for rendering, and when to start; a notify is requested
+    // for it, so WaitEvents wakes at that vblank and the prediction stays calibrated
+    xcb::frame_target_t NextFrame( clock::duration budget );
+    // the frame aimed at target has been submitted; returns how many vblanks it missed
+    uint64_t        FrameDone( const xcb::frame_target_t& target ) { return _frames.frame_done( target, clock::now() ); }
+    const xcb::frame_scheduler& FrameScheduler() const { return _frames; }
+
+    // exclusive fullscreen on one RandR output, the primary one for an empty name: the window
+    // covers exactly that output and asks the compositor to stop redirecting it. Returns false
+    // without RandR 1.3 or when no such output is lit. A WindowOutputEvent reports the output
+    // and its refresh rate on the next poll, and again whenever the output changes
+    bool            SetFullscreen( bool enable, std::string_view output = {} );
+    const std::optional<display_output_t>& FullscreenOutput() const { return _fullscreen_output; }
+
+    // serve selection (CLIPBOARD, PRIMARY, ...) from sources until another client takes it over;
+    // other target atoms come from atom_request_t
+    void            SetSelection( xcb_atom_t selection, std::vector<selection_source_t> sources );
+    void            ClearSelection( xcb_atom_t selection );
+    bool            OwnsSelection( xcb_atom_t selection ) const { return _selection && _selection->Owns( selection ); }
+    // streams target of selection into sink over the following polls; see XCBSelection
+    void            RequestSelection( xcb_atom_t selection, xcb_atom_t target, selection_sink sink );
+
+    // record every raw event this window translates, with its timestamps, for XCBReplayWindow
+    bool            StartTrace( const std::string& path );
+    void            StopTrace() { _trace = {}; }
 protected:
+    // an offline window translating events from a trace; see XCBReplayWindow
+                    XCBWindow( const WindowProperties& props, const xcb::trace_header_t& trace );
     virtual         ~XCBWindow();
+
+    // translates everything in the window's queue; owned events came from libxcb and are freed
+    void            ProcessQueue( clock::time_point dispatched, bool owned = true );
+    void            TranslateEvent( const xcb::queued_event_t& queued );
+    void            TranslateXInput( const xcb_ge_generic_event_t* event );
+    void            TranslatePresent( const xcb_ge_generic_event_t* event, clock::time_point received );
+    void            RequestVblank( uint64_t msc );
+    void            TrackPointer( double x, double y, xcb_timestamp_t time );
+    template<typename E, typename... Args> void Emit( Args&&... args );
+    template<typename E, typename... Args> void EmitAt( clock::time_point time, Args&&... args );
+    void            FlushMotion();
+    XCBSelection&   Selection();
+    void            CoverOutput( const display_output_t& output );
+    void            UpdateOutput( clock::time_point now );
+    void            SendFullscreenState( bool fullscreen );
+    window_geometry_t CurrentGeometry() const;
+    // what the window itself needs selected on top of the requested mask
+    uint32_t        RequiredEventMask() const;
+    // selects the requested and required events, if that changes anything
+    void            UpdateEventMask();
 protected:
+    ref_ptr<XCBConnection> _display;
     xcb_connection_t*   _connection = nullptr;
     xcb_screen_t*       _screen     = nullptr;
     xcb_window_t        _window{};
+    xcb_window_t        _root{};
+    xcb_window_t        _parent{};
     xcb_atom_t          _window_delete_protocol{};
-    xcb_timestamp_t     _first_xcb_timestamp = 0;
-    clock::time_point   _first_xcb_time_point;
+    XCBConnection::event_queue* _queue = nullptr;
+    uint32_t            _event_mask    = default_event_mask;
+    uint32_t            _selected_mask = 0;     // as last sent to the server
+
+    bool                            _coalesce_motion = false;
+    std::vector<pointer_sample_t>   _motion_history;
+    std::optional<pointer_sample_t> _pending_motion;
+    uint8_t                         _pointer_input = POINTER_CORE;
+    std::optional<pointer_delta_t>  _pending_raw_motion;
+    std::optional<pointer_delta_t>  _pending_scroll;
+
+    damage_region                   _damage;
+    std::optional<clock::time_point> _damage_time;      // set once a run of exposes is complete
+
+    clock::time_point               _event_time;
+    xcb_timestamp_t                 _server_time = XCB_CURRENT_TIME;   // of the last event that had one
+    typed_events_t*                 _typed_events = nullptr;    // set while a typed poll runs
+    event_pool::owner               _event_pool;
+    input_latency_t                 _latency;
+
+    std::optional<window_geometry_t>                  _pending_configure;
+    std::optional<clock::time_point>                  _pending_configure_time;
+    std::optional<xcb_translate_coordinates_cookie_t> _position_request;
+    bool                                              _position_stale = false;
+
+    xcb::frame_scheduler                              _frames;
+    xcb_present_event_t                               _present_event{};     // 0 while pacing is off
+    uint32_t                                          _present_serial = 0;
+    std::optional<uint64_t>                           _requested_msc;
+
+    std::optional<display_output_t>                   _fullscreen_output;   // as last reported
+    std::string                                       _fullscreen_name;     // as asked for, empty for the primary
+    std::optional<window_geometry_t>                  _windowed;            // restored when leaving fullscreen
+    uint32_t                                          _output_changes = 0;  // RandR configuration last looked at
+    bool                                              _output_pending = false;
+
+    ref_ptr<xcb::trace_writer>                        _trace;
+    ref_ptr<XCBFramebuffer>                           _framebuffer;
+    ref_ptr<XCBSelection>                             _selection;
 };
 
 } // namespace aer
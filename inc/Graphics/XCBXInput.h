@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Base/Base.h>
+
+#include <xcb/xcb.h>
+#include <xcb/xinput.h>
+
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace aer::xcb
+{
+
+// a master pointer valuator that reports scrolling as an ever-growing absolute value
+struct scroll_valuator_t
+{
+    xcb_input_device_id_t   device{};
+    uint16_t                number{};
+    bool                    horizontal = false;
+    double                  increment  = 1.0;   // valuator units per wheel detent
+    std::optional<double>   last;               // previous value; deltas restart when unknown
+};
+
+// the XInput 2.1+ extension as seen by one connection. Querying it costs round-trips, so it
+// is only set up once a window asks for XInput2 pointer input
+struct xinput : Object
+{
+    static constexpr size_t max_scroll_valuators = 16;
+
+    // queries extension, version and master devices; opcode stays 0 when XInput 2.1 is missing
+    xinput( xcb_connection_t* connection );
+    // fixed state, for Offline connections
+    xinput( uint8_t opcode, std::span<const scroll_valuator_t> valuators );
+
+    bool                available() const { return opcode != 0; }
+    scroll_valuator_t*  find_scroll( xcb_input_device_id_t device, uint16_t number );
+    // a master's classes follow whichever slave moved last; old positions are meaningless
+    void                update_device( const xcb_input_device_changed_event_t* changed );
+    // forget every valuator position, after the pointer left and came back for instance
+    void                reset_scroll();
+
+    static double       to_double( xcb_input_fp3232_t value ) { return value.integral + value.frac / 4294967296.0; }
+    static double       to_double( xcb_input_fp1616_t value ) { return value / 65536.0; }
+
+    uint8_t                         opcode = 0;
+    std::vector<scroll_valuator_t>  scroll_valuators;
+protected:
+    void                add_classes( xcb_input_device_id_t device, xcb_input_device_class_iterator_t classes );
+};
+
+// selects XI2 events for every master device on a window; an empty mask removes the selection
+void xinput_select( xcb_connection_t* connection, xcb_window_t window, uint32_t mask );
+
+} // namespace aer::xcb
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Base/Base.h>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+
+namespace aer
+{
+
+// multiplexes any number of file descriptors, timers and cross-thread wakeups through one epoll_wait
+class EventLoop : public Object
+{
+public:
+    using clock    = std::chrono::steady_clock;
+    using callback = std::function<void( uint32_t events )>;
+    using pending  = std::function<bool()>;
+
+                    EventLoop();
+
+    // watch a caller-owned fd; has_pending reports input already buffered in user space,
+    // which stops Dispatch from sleeping on an fd that will not become readable again
+    int             AddSource( int fd, uint32_t events, callback on_ready, pending has_pending = {} );
+    // timerfd owned by the loop; on_expire receives the number of expirations
+    int             AddTimer( clock::duration interval, callback on_expire, bool repeat = true );
+    // eventfd owned by the loop, raised from any thread with Signal
+    int             AddWakeup( callback on_wake );
+    void            Signal( int wakeup );
+    void            Remove( int fd );
+
+    // sleeps until a source is ready or timeout expires, then runs the ready callbacks;
+    // returns the number of callbacks run
+    size_t          Dispatch( std::optional<clock::duration> timeout = std::nullopt );
+    // makes a blocked Dispatch return early, from any thread
+    void            Interrupt();
+protected:
+    virtual         ~EventLoop();
+
+    enum class source_kind : uint8_t { FD, TIMER, WAKEUP };
+    struct source_t
+    {
+        source_kind kind;
+        callback    on_ready;
+        pending     has_pending;
+    };
+
+    int             Add( int fd, uint32_t events, std::shared_ptr<source_t> source );
+protected:
+    int                                                 _epoll     = -1;
+    int                                                 _interrupt = -1;
+    std::unordered_map<int, std::shared_ptr<source_t>>  _sources;
+};
+
+} // namespace aer
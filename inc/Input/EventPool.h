@@ -0,0 +1,166 @@
+#pragma once
+
+#include <Base/Base.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+namespace aer
+{
+
+struct event_pool_stats_t
+{
+    uint64_t allocations{};     // blocks taken from the heap
+    uint64_t recycled{};        // blocks served from a free list
+};
+
+// the blocks for the event objects of one window or input source, one intrusive free list per
+// size class. Blocks are taken on the polling thread only; a released event may be dropped on
+// any thread and goes back to the pool it came from. The pool lives until its owner and every
+// outstanding block are gone, so events can outlive their window
+class event_pool
+{
+    struct node_t { node_t* next; };
+
+    // precedes every block; names the pool and list it goes back to
+    struct alignas( std::max_align_t ) header_t
+    {
+        event_pool* pool;
+        uint32_t    size_class;
+    };
+public:
+    static constexpr std::size_t block_align = alignof( std::max_align_t );
+    static constexpr std::size_t class_size  = 16;
+    static constexpr std::size_t num_classes = 16;      // blocks up to 256 bytes are recycled
+
+    // the owner's reference
+    class owner
+    {
+    public:
+                    owner() : _pool( new event_pool ) {}
+                    ~owner() { _pool->drop(); }
+                    owner( const owner& ) = delete;
+        owner&      operator=( const owner& ) = delete;
+
+        event_pool& operator*() const  { return *_pool; }
+        event_pool* operator->() const { return _pool; }
+    private:
+        event_pool* _pool;
+    };
+
+    // every pool together
+    static event_pool_stats_t stats()
+    {
+        return { _allocations.load( std::memory_order_relaxed ), _recycled.load( std::memory_order_relaxed ) };
+    }
+
+    void* acquire( std::size_t size )
+    {
+        const auto index = size_class( size );
+        if( index >= num_classes )
+        {
+            // oversized blocks bypass the lists and go straight back to the heap
+            auto header = allocate( size );
+            *header = { nullptr, 0 };
+            return header + 1;
+        }
+
+        auto& head = _cache[index];
+        if( !head ) head = _returned[index].exchange( nullptr, std::memory_order_acquire );
+        header_t* header = nullptr;
+        if( auto node = head )
+        {
+            head   = node->next;
+            header = reinterpret_cast<header_t*>( node );
+            _recycled.fetch_add( 1, std::memory_order_relaxed );
+        }
+        else header = allocate( ( index + 1 ) * class_size );
+
+        *header = { this, static_cast<uint32_t>( index ) };
+        _refs.fetch_add( 1, std::memory_order_relaxed );
+        return header + 1;
+    }
+
+    static void release( void* ptr ) noexcept
+    {
+        auto header = static_cast<header_t*>( ptr ) - 1;
+        auto pool   = header->pool;
+        if( !pool ) return ::operator delete( header, std::align_val_t{ block_align } );
+
+        auto& list = pool->_returned[header->size_class];
+        auto node  = reinterpret_cast<node_t*>( header );
+        node->next = list.load( std::memory_order_relaxed );
+        while( !list.compare_exchange_weak( node->next, node, std::memory_order_release, std::memory_order_relaxed ) );
+        pool->drop();
+    }
+
+    // fills the list for objects of size up front
+    void reserve( std::size_t size, std::size_t count )
+    {
+        const auto index = size_class( size );
+        if( index >= num_classes ) return;
+        for( std::size_t i = 0; i < count; ++i )
+        {
+            auto node = reinterpret_cast<node_t*>( allocate( ( index + 1 ) * class_size ) );
+            node->next = _cache[index];
+            _cache[index] = node;
+        }
+    }
+protected:
+                    event_pool() = default;
+                    ~event_pool()
+    {
+        for( std::size_t i = 0; i < num_classes; ++i )
+        {
+            for( auto list : { _cache[i], _returned[i].load( std::memory_order_acquire ) } )
+            {
+                while( auto node = list )
+                {
+                    list = node->next;
+                    ::operator delete( node, std::align_val_t{ block_align } );
+                }
+            }
+        }
+    }
+
+    static std::size_t size_class( std::size_t size ) { return size ? ( size - 1 ) / class_size : 0; }
+
+    static header_t* allocate( std::size_t size )
+    {
+        _allocations.fetch_add( 1, std::memory_order_relaxed );
+        return static_cast<header_t*>( ::operator new( sizeof( header_t ) + size, std::align_val_t{ block_align } ) );
+    }
+
+    void drop() noexcept
+    {
+        if( _refs.fetch_sub( 1, std::memory_order_acq_rel ) == 1 ) delete this;
+    }
+protected:
+    static inline std::atomic<uint64_t> _allocations{ 0 };
+    static inline std::atomic<uint64_t> _recycled{ 0 };
+
+    std::atomic<uint64_t>                           _refs{ 1 };     // the owner's and one per outstanding block
+    std::array<node_t*, num_classes>                _cache{};       // polling thread only
+    std::array<std::atomic<node_t*>, num_classes>   _returned{};    // released from any thread
+};
+
+// event type whose storage comes from an event_pool, as new( pool ) pooled<E>( ... ); deleting the
+// last ref_ptr goes through the virtual destructor, which picks up this operator delete.
+// Only the event objects are pooled: each still costs a std::list node in Events, and a
+// WindowDamageEvent its vector of rects, both from the heap. Polls that must not allocate at
+// all use the typed_events_t overloads instead
+template<typename T>
+struct pooled : T
+{
+    static_assert( alignof( T ) <= event_pool::block_align );
+    using T::T;
+
+    static void* operator new( std::size_t size, event_pool& pool ) { return pool.acquire( size ); }
+    // only reached when a constructor throws
+    static void operator delete( void* ptr, event_pool& ) noexcept { event_pool::release( ptr ); }
+    static void operator delete( void* ptr ) noexcept { event_pool::release( ptr ); }
+};
+
+} // namespace aer
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <stop_token>
+
+namespace aer
+{
+
+// lock-free single-producer single-consumer ring; the producer blocks while it is full, until
+// the consumer frees a slot or a stop is requested
+template<typename T, std::size_t Capacity>
+class event_ring
+{
+    static_assert( std::has_single_bit( Capacity ), "event_ring capacity must be a power of two" );
+    static constexpr std::size_t mask       = Capacity - 1;
+    static constexpr std::size_t cache_line = 64;
+public:
+    bool push( const T& value )
+    {
+        const auto head = _head.load( std::memory_order_relaxed );
+        if( head - _tail.load( std::memory_order_acquire ) == Capacity ) return false;
+        _slots[head & mask] = value;
+        _head.store( head + 1, std::memory_order_release );
+        return true;
+    }
+
+    // false when stop was requested before a slot came free; value then stays with the caller
+    bool push_wait( const T& value, std::stop_token stop = {} )
+    {
+        if( push( value ) ) return true;
+
+        // the producer sleeps on a counter that both freeing slots and a stop request bump,
+        // so a consumer that never drains again cannot keep it from seeing the stop
+        std::stop_callback wake( stop, [this]
+        {
+            _released.fetch_add( 1, std::memory_order_release );
+            _released.notify_one();
+        });
+        for( ;; )
+        {
+            const auto released = _released.load( std::memory_order_acquire );
+            if( stop.stop_requested() ) return false;
+            if( push( value ) ) return true;
+            _released.wait( released, std::memory_order_acquire );
+        }
+    }
+
+    // hands every queued entry to fn, then releases all the slots at once
+    template<typename F>
+    std::size_t consume( F&& fn )
+    {
+        const auto tail = _tail.load( std::memory_order_relaxed );
+        const auto head = _head.load( std::memory_order_acquire );
+        for( auto i = tail; i != head; ++i ) fn( _slots[i & mask] );
+        if( head != tail )
+        {
+            _tail.store( head, std::memory_order_release );
+            _released.fetch_add( 1, std::memory_order_release );
+            _released.notify_one();
+        }
+        return head - tail;
+    }
+
+    bool empty() const { return _head.load( std::memory_order_acquire ) == _tail.load( std::memory_order_acquire ); }
+private:
+    alignas( cache_line ) std::atomic<std::size_t> _head{ 0 };
+    alignas( cache_line ) std::atomic<std::size_t> _tail{ 0 };
+    std::atomic<uint32_t>   _released{ 0 };     // bumped by every consume that frees slots
+    std::array<T, Capacity> _slots{};
+};
+
+} // namespace aer
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <Base/Base.h>
+#include <Base/Event.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <optional>
+#include <utility>
+
+namespace aer
+{
+
+using input_clock = std::chrono::steady_clock;
+
+struct event_timestamp_t
+{
+    input_clock::time_point time{};
+};
+
+// adds the moment the input happened, on the local steady clock, to an event type
+template<typename T>
+struct timestamped : T, event_timestamp_t
+{
+    template<typename... Args>
+    timestamped( input_clock::time_point when, Args&&... args )
+    :   T( std::forward<Args>( args )... ),
+        event_timestamp_t{ when }
+    {}
+};
+
+inline std::optional<input_clock::time_point> event_time( const Event* event )
+{
+    if( auto stamp = dynamic_cast<const event_timestamp_t*>( event ) ) return stamp->time;
+    return std::nullopt;
+}
+
+// log2-bucketed latency histogram; bucket i counts samples in [2^(i-1), 2^i) microseconds
+struct latency_histogram_t
+{
+    static constexpr size_t num_buckets = 32;
+
+    std::array<uint64_t, num_buckets> buckets{};
+    uint64_t                          count{};
+    input_clock::duration             total{};
+    input_clock::duration             max{};
+
+    void record( input_clock::duration latency )
+    {
+        if( latency < input_clock::duration::zero() ) latency = input_clock::duration::zero();
+        const auto us = static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::microseconds>( latency ).count() );
+        ++buckets[std::min<size_t>( std::bit_width( us ), num_buckets - 1 )];
+        ++count;
+        total += latency;
+        if( latency > max ) max = latency;
+    }
+
+    input_clock::duration mean() const { return count ? total / static_cast<int64_t>( count ) : input_clock::duration::zero(); }
+
+    // upper bound of the bucket holding the given quantile, in [0, 1]
+    input_clock::duration percentile( double quantile ) const
+    {
+        if( count == 0 ) return input_clock::duration::zero();
+        const auto target = static_cast<uint64_t>( quantile * count );
+        uint64_t seen = 0;
+        for( size_t i = 0; i < num_buckets; ++i )
+        {
+            seen += buckets[i];
+            if( seen > target || seen == count ) return std::chrono::microseconds( uint64_t{ 1 } << i );
+        }
+        return max;
+    }
+
+    void reset() { *this = {}; }
+};
+
+struct input_latency_t
+{
+    latency_histogram_t server_to_dequeue;      // input timestamp to leaving the transport's queue; for a remote
+                                                // X server, in excess of the least delayed event's
+    latency_histogram_t dequeue_to_dispatch;    // leaving the transport's queue to translation in PollEvents
+};
+
+} // namespace aer
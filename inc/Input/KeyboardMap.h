@@ -0,0 +1,86 @@
+#pragma once
+
+#include <Input/KeyCodes.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace aer
+{
+
+// modifier bits as X reports them in the state of key and button events
+enum modifier_mask : uint16_t
+{
+    MODIFIER_SHIFT      = 1 << 0,
+    MODIFIER_LOCK       = 1 << 1,
+    MODIFIER_CONTROL    = 1 << 2,
+    MODIFIER_1          = 1 << 3,
+    MODIFIER_2          = 1 << 4,
+    MODIFIER_3          = 1 << 5,
+    MODIFIER_4          = 1 << 6,
+    MODIFIER_5          = 1 << 7
+};
+
+// keysyms by X keycode; xcb::keyboard_map fills one from the
+// server's mapping, LinuxInput from a built-in layout or a caller's table
+struct keycode_map
+{
+    // keycodes are a single byte on the wire, so a 256 row table covers every possible code;
+    // only the unshifted and shifted levels are ever consulted
+    static constexpr size_t num_keycodes = 256;
+    static constexpr size_t num_levels   = 2;
+    using code_map = std::array<std::array<key::symbol, num_levels>, num_keycodes>;
+
+    keycode_map() = default;
+    keycode_map( const code_map& codes )
+    :   _keymap( codes )
+    {}
+
+    const code_map& codes() const { return _keymap; }
+
+    key_symbol symbol( uint8_t keycode, uint16_t modifier = 0 ) const
+    {
+        const auto& row = _keymap[keycode];
+        const auto base_key = row[0];
+        if( modifier == 0 || base_key == KEY_Undefined ) return static_cast<key_symbol>( base_key );
+
+        bool shift = (modifier & key::MOD_Shift) != 0;
+        bool numpad = base_key >= KEY_KP_Space && base_key <= KEY_KP_Divide;
+        bool level = numpad ? ( (modifier & key::MOD_NumLock) != 0 && !shift )
+                            : ( (modifier & key::MOD_CapsLock) != 0 && shift );
+        return static_cast<key_symbol>( row[level] );
+    }
+
+    key::mod mod( key::symbol symbol, uint16_t modifier, bool pressed ) const
+    {
+        uint16_t mask{ 0 };
+        if( symbol >= KEY_Shift_L && symbol <= KEY_Hyper_R )
+        {
+            switch( symbol )
+            {
+                case KEY_Shift_L:
+                case KEY_Shift_R:   mask = MODIFIER_SHIFT; break;
+                case KEY_Control_L:
+                case KEY_Control_R: mask = MODIFIER_CONTROL; break;
+                // Meta shares Mod1 with Alt as in X's default modifier map, which gives Mod2 to Num_Lock
+                case KEY_Alt_L:
+                case KEY_Alt_R:
+                case KEY_Meta_L:
+                case KEY_Meta_R:    mask = MODIFIER_1; break;
+                case KEY_Hyper_L:
+                case KEY_Hyper_R:   mask = MODIFIER_3; break;
+                case KEY_Super_L:
+                case KEY_Super_R:   mask = MODIFIER_4; break;
+                default: break;
+            }
+        }
+        pressed ? modifier |= mask : modifier &= ~mask;
+        return key::mod{ modifier };
+    }
+
+protected:
+    code_map _keymap{};
+};
+
+} // namespace aer
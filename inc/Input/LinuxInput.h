@@ -1,8 +1,117 @@
 #pragma once
 
+#include <Base/Base.h>
+#include <Base/Event.h>
+#include <Graphics/Window.h>
+#include <Input/EventRing.h>
+#include <Input/EventPool.h>
+#include <Input/EventTime.h>
+#include <Input/KeyboardMap.h>
+#include <Input/TypedEvents.h>
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 namespace aer
 {
-    
 
+// one struct input_event as read from a device, tagged with the fd it came from
+struct evdev_event_t
+{
+    input_clock::time_point time{};
+    int                     fd = -1;
+    uint16_t                type{};
+    uint16_t                code{};
+    int32_t                 value{};
+};
+
+// direct evdev input: watches /dev/input/event* nodes, or any fd carrying raw struct input_event
+// records such as a pipe replaying a capture, and translates them into the same key, mouse and
+// scroll events XCBWindow produces, stamped with the kernel's time. No X server is involved.
+class LinuxInput : public Object
+{
+public:
+    using clock = input_clock;
+
+    // events are addressed to window; keymap is indexed by X keycode (evdev code + 8) and
+    // defaults to a built-in US layout
+                    LinuxInput( Window* window = nullptr, std::optional<keycode_map::code_map> keymap = std::nullopt );
+
+    // opens every readable event node in directory; returns how many were added
+    size_t          OpenDevices( const std::string& directory = "/dev/input", bool grab = false );
+    // grabbing keeps the device's input from reaching anything else, X included
+    int             Open( const std::string& path, bool grab = false );
+    // watches a caller-supplied fd; owned fds are closed when removed or at end of stream
+    int             AddDevice( int fd, bool owned = false );
+    void            RemoveDevice( int fd );
+    size_t          DeviceCount() const { return _devices.size(); }
+
+    // relative motion is clamped to and absolute axes scaled onto [0, width) x [0, height);
+    // 0 leaves relative motion unbounded and absolute axes in device units
+    void            SetPointerBounds( uint32_t width, uint32_t height ) { _width = width; _height = height; }
+    // report high resolution wheels as MouseSmoothScrollEvent instead of whole MouseScrollEvent detents
+    void            SetSmoothScroll( bool enable ) { _smooth_scroll = enable; }
+
+    // an epoll fd, readable whenever a device is; for use with EventLoop::AddSource
+    int             FileDescriptor() const { return _epoll; }
+    // reads and translates everything available without blocking
+    bool            PollEvents( Events& events );
+    // as above, into per-category records; see XCBWindow::PollEvents
+    bool            PollEvents( typed_events_t& events );
+    bool            WaitEvents( Events& events, std::optional<clock::duration> timeout = std::nullopt );
+protected:
+    virtual         ~LinuxInput();
+
+    struct axis_t
+    {
+        int32_t     minimum = 0;
+        int32_t     maximum = 0;        // equal to minimum when the device did not report a range
+    };
+
+    // everything a device reports between two SYN_REPORTs happens at once
+    struct device_t
+    {
+        int                         fd = -1;
+        bool                        owned = false;
+        axis_t                      abs_x;
+        axis_t                      abs_y;
+        std::vector<std::byte>      partial;            // a record split across reads
+        bool                        dropped = false;    // the kernel overflowed; skip to the next report
+        bool                        hires_wheel = false;
+
+        double                      dx = 0, dy = 0;
+        std::optional<int32_t>      abs_position_x, abs_position_y;
+        int32_t                     wheel = 0, hwheel = 0;
+        int32_t                     hires = 0, hhires = 0;
+        std::vector<evdev_event_t>  buttons;            // keys and buttons, in report order
+    };
+
+    // false once the stream has ended
+    bool            ReadDevice( device_t& device );
+    void            Translate( const evdev_event_t& event );
+    void            EndFrame( device_t& device, clock::time_point time );
+    void            KeyChange( const evdev_event_t& event );
+    template<typename E, typename... Args> void Emit( clock::time_point time, Args&&... args );
+protected:
+    static constexpr size_t ring_size = 1024;
+
+    Window*                             _window = nullptr;
+    keycode_map                         _keymap;
+    int                                 _epoll = -1;
+    std::unordered_map<int, device_t>   _devices;
+    event_ring<evdev_event_t, ring_size> _ring;
+    Events                              _events;
+    event_pool::owner                   _event_pool;
+    typed_events_t*                     _typed_events = nullptr;
+
+    bool                                _smooth_scroll = false;
+    uint16_t                            _modifiers = 0;     // X modifier mask of the held modifiers
+    uint16_t                            _locks = 0;         // and of the latched Caps_Lock and Num_Lock
+    double                              _x = 0, _y = 0;
+    uint32_t                            _width = 0, _height = 0;
+};
 
 } // namespace aer
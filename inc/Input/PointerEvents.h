@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Events/MouseEvents.h>
+#include <Events/WindowEvents.h>
+
+namespace aer
+{
+
+// unaccelerated relative pointer motion in device units, summed over the events of one poll;
+// not clamped to the window, so it keeps coming while the pointer is pinned at an edge
+struct MouseRawMotionEvent : WindowEvent
+{
+    double dx;
+    double dy;
+
+    MouseRawMotionEvent( Window* window, double in_dx, double in_dy )
+    :   WindowEvent( window ),
+        dx( in_dx ),
+        dy( in_dy )
+    {}
+};
+
+// fractional scrolling in wheel detents, summed over the events of one poll; positive dy
+// scrolls up and positive dx scrolls right, matching MouseScrollEvent
+struct MouseSmoothScrollEvent : MouseEvent
+{
+    double dx;
+    double dy;
+
+    MouseSmoothScrollEvent( Window* window, int32_t x, int32_t y, double in_dx, double in_dy )
+    :   MouseEvent( window, x, y ),
+        dx( in_dx ),
+        dy( in_dy )
+    {}
+};
+
+} // namespace aer
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <Graphics/DamageRegion.h>
+#include <Graphics/DisplayOutput.h>
+#include <Input/EventTime.h>
+#include <Input/KeyCodes.h>
+#include <Input/MouseCodes.h>
+#include <Input/PointerEvents.h>
+
+#include <Events/KeyEvents.h>
+#include <Events/MouseEvents.h>
+#include <Events/WindowEvents.h>
+
+#include <span>
+#include <vector>
+
+namespace aer
+{
+
+// Plain records of the events a window emits, one contiguous array per category. They carry no
+// Window pointer and no refcount; order says where each stood in the poll across categories.
+
+struct window_record_t
+{
+    enum kind_t : uint8_t { CLOSE, FOCUS, UNFOCUS, CONFIGURE, DAMAGE, OUTPUT };
+
+    input_clock::time_point time{};
+    uint32_t                order{};
+    kind_t                  kind{};
+    int32_t                 x{};            // CONFIGURE: geometry, DAMAGE: bounds of the rects, OUTPUT: the output's
+    int32_t                 y{};
+    uint32_t                width{};
+    uint32_t                height{};
+    uint32_t                first_rect{};   // DAMAGE: rects[first_rect, first_rect + rect_count)
+    uint32_t                rect_count{};
+    uint32_t                refresh_mhz{};  // OUTPUT: refresh rate of its mode
+};
+
+struct key_record_t
+{
+    input_clock::time_point time{};
+    uint32_t                order{};
+    bool                    pressed{};
+    key_symbol              key{};
+    key_symbol              modified{};
+    key::mod                mod{};
+};
+
+struct mouse_record_t
+{
+    enum kind_t : uint8_t { MOVE, DOWN, UP, SCROLL, SMOOTH_SCROLL, RAW_MOTION };
+
+    input_clock::time_point time{};
+    uint32_t                order{};
+    kind_t                  kind{};
+    int32_t                 x{};            // pointer position, unused for RAW_MOTION
+    int32_t                 y{};
+    mouse_button            button = MOUSE_None;
+    double                  dx{};           // SCROLL: whole detents in dy, others as in the event classes
+    double                  dy{};
+};
+
+struct typed_events_t
+{
+    std::vector<window_record_t>    window;
+    std::vector<key_record_t>       keys;
+    std::vector<mouse_record_t>     mouse;
+    std::vector<framebuffer_rect_t> rects;
+
+    bool        empty() const { return window.empty() && keys.empty() && mouse.empty(); }
+    size_t      size() const  { return window.size() + keys.size() + mouse.size(); }
+    // keeps the capacity, so a reused instance stops allocating after the first few polls
+    void        clear() { window.clear(); keys.clear(); mouse.clear(); rects.clear(); }
+};
+
+// maps each event class to its record at compile time; emitting a class with no
+// specialization here fails to build rather than silently dropping the event
+template<typename E> struct event_record;
+
+template<> struct event_record<WindowCloseEvent>
+{
+    static void append( typed_events_t& events, input_clock::time_point time )
+    {
+        events.window.push_back( { time, static_cast<uint32_t>( events.size() ), window_record_t::CLOSE } );
+    }
+};
+
+template<> struct event_record<WindowFocusEvent>
+{
+    static void append( typed_events_t& events, input_clock::time_point time )
+    {
+        events.window.push_back( { time, static_cast<uint32_t>( events.size() ), window_record_t::FOCUS } );
+    }
+};
+
+template<> struct event_record<WindowUnfocusEvent>
+{
+    static void append( typed_events_t& events, input_clock::time_point time )
+    {
+        events.window.push_back( { time, static_cast<uint32_t>( events.size() ), window_record_t::UNFOCUS } );
+    }
+};
+
+template<> struct event_record<WindowConfigureEvent>
+{
+    static void append( typed_events_t& events, input_clock::time_point time, int32_t x, int32_t y, uint32_t width, uint32_t height )
+    {
+        events.window.push_back( { time, static_cast<uint32_t>( events.size() ), window_record_t::CONFIGURE, x, y, width, height } );
+    }
+};
+
+template<> struct event_record<WindowDamageEvent>
+{
+    static void append( typed_events_t& events, input_clock::time_point time, std::span<const framebuffer_rect_t> rects )
+    {
+        const auto bounds = bounding_rect( rects );
+        events.window.push_back
+        ({
+            time, static_cast<uint32_t>( events.size() ), window_record_t::DAMAGE, bounds.x, bounds.y, bounds.width, bounds.height,
+            static_cast<uint32_t>( events.rects.size() ), static_cast<uint32_t>( rects.size() )
+        });
+        events.rects.insert( events.rects.end(), rects.begin(), rects.end() );
+    }
+};
+
+template<> struct event_record<WindowOutputEvent>
+{
+    static void append( typed_events_t& events, input_clock::time_point time, const display_output_t& output )
+    {
+        events.window.push_back
+        ({
+            time, static_cast<uint32_t>( events.size() ), window_record_t::OUTPUT, output.x, output.y, output.width, output.height,
+            0, 0, output.refresh_mhz
+        });
+    }
+};
+
+template<> struct event_record<KeyDownEvent>
+{
+    static void append( typed_events_t& events, input_clock::time_point time, key_symbol key, key_symbol modified, key::mod mod )
+    {
+        events.keys.push_back( { time, static_cast<uint32_t>( events.size() ), true, key, modified, mod } );
+    }
+};
+
+template<> struct event_record<KeyUpEvent>
+{
+    static void append( typed_events_t& events, input_clock::time_point time, key_symbol key, key_symbol modified, key::mod mod )
+    {
+        events.keys.push_back( { time, static_cast<uint32_t>( events.size() ), false, key, modified, mod } );
+    }
+};
+
+template<> struct event_record<MouseMoveEvent>
+{
+    static void append( typed_events_t& events, input_clock::time_point time, int32_t x, int32_t y )
+    {
+        events.mouse.push_back( { time, static_cast<uint32_t>( events.size() ), mouse_record_t::MOVE, x, y } );
+    }
+};
+
+template<> struct event_record<MouseDownEvent>
+{
+    static void append( typed_events_t& events, input_clock::time_point time, int32_t x, int32_t y, mouse_button button )
+    {
+        events.mouse.push_back( { time, static_cast<uint32_t>( events.size() ), mouse_record_t::DOWN, x, y, button } );
+    }
+};
+
+template<> struct event_record<MouseUpEvent>
+{
+    static void append( typed_events_t& events, input_clock::time_point time, int32_t x, int32_t y, mouse_button button )
+    {
+        events.mouse.push_back( { time, static_cast<uint32_t>( events.size() ), mouse_record_t::UP, x, y, button } );
+    }
+};
+
+template<> struct event_record<MouseScrollEvent>
+{
+    static void append( typed_events_t& events, input_clock::time_point time, int32_t x, int32_t y, int32_t delta )
+    {
+        events.mouse.push_back( { time, static_cast<uint32_t>( events.size() ), mouse_record_t::SCROLL, x, y, MOUSE_None, 0.0, double( delta ) } );
+    }
+};
+
+template<> struct event_record<MouseSmoothScrollEvent>
+{
+    static void append( typed_events_t& events, input_clock::time_point time, int32_t x, int32_t y, double dx, double dy )
+    {
+        events.mouse.push_back( { time, static_cast<uint32_t>( events.size() ), mouse_record_t::SMOOTH_SCROLL, x, y, MOUSE_None, dx, dy } );
+    }
+};
+
+template<> struct event_record<MouseRawMotionEvent>
+{
+    static void append( typed_events_t& events, input_clock::time_point time, double dx, double dy )
+    {
+        events.mouse.push_back( { time, static_cast<uint32_t>( events.size() ), mouse_record_t::RAW_MOTION, 0, 0, MOUSE_None, dx, dy } );
+    }
+};
+
+} // namespace aer
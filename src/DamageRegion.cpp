@@ -0,0 +1,94 @@
+#include <Graphics/DamageRegion.h>
+
+#include <algorithm>
+#include <limits>
+#include <tuple>
+
+namespace aer
+{
+
+namespace
+{
+    int64_t right( const framebuffer_rect_t& rect )  { return int64_t{ rect.x } + rect.width; }
+    int64_t bottom( const framebuffer_rect_t& rect ) { return int64_t{ rect.y } + rect.height; }
+    uint64_t area( const framebuffer_rect_t& rect )  { return uint64_t{ rect.width } * rect.height; }
+
+    framebuffer_rect_t unite( const framebuffer_rect_t& a, const framebuffer_rect_t& b )
+    {
+        const auto x = std::min( a.x, b.x );
+        const auto y = std::min( a.y, b.y );
+        return { x, y, static_cast<uint32_t>( std::max( right( a ), right( b ) ) - x ), static_cast<uint32_t>( std::max( bottom( a ), bottom( b ) ) - y ) };
+    }
+
+    // bounding box area beyond what the two cover on their own; 0 or less means merging is free
+    int64_t merge_cost( const framebuffer_rect_t& a, const framebuffer_rect_t& b )
+    {
+        return static_cast<int64_t>( area( unite( a, b ) ) ) - static_cast<int64_t>( area( a ) + area( b ) );
+    }
+}
+
+void damage_region::add( const framebuffer_rect_t& rect )
+{
+    if( rect.width == 0 || rect.height == 0 ) return;
+
+    // a merge grows the rect, which can make an earlier neighbour free to absorb as well
+    auto merged = rect;
+    for( auto itr = _rects.begin(); itr != _rects.end(); )
+    {
+        if( merge_cost( *itr, merged ) <= 0 )
+        {
+            merged = unite( *itr, merged );
+            _rects.erase( itr );
+            itr = _rects.begin();
+        }
+        else ++itr;
+    }
+    _rects.push_back( merged );
+
+    while( _rects.size() > max_rects )
+    {
+        size_t first = 0, second = 1;
+        int64_t cheapest = std::numeric_limits<int64_t>::max();
+        for( size_t i = 0; i < _rects.size(); ++i )
+        {
+            for( size_t j = i + 1; j < _rects.size(); ++j )
+            {
+                const auto cost = merge_cost( _rects[i], _rects[j] );
+                if( cost < cheapest ) std::tie( first, second, cheapest ) = std::tuple( i, j, cost );
+            }
+        }
+        _rects[first] = unite( _rects[first], _rects[second] );
+        _rects.erase( _rects.begin() + second );
+    }
+}
+
+void damage_region::clip( uint32_t width, uint32_t height )
+{
+    for( auto& rect : _rects )
+    {
+        const int64_t x0 = std::max<int64_t>( rect.x, 0 );
+        const int64_t y0 = std::max<int64_t>( rect.y, 0 );
+        const int64_t x1 = std::min<int64_t>( right( rect ), width );
+        const int64_t y1 = std::min<int64_t>( bottom( rect ), height );
+        rect = { static_cast<int32_t>( x0 ), static_cast<int32_t>( y0 ),
+                 static_cast<uint32_t>( std::max<int64_t>( x1 - x0, 0 ) ), static_cast<uint32_t>( std::max<int64_t>( y1 - y0, 0 ) ) };
+    }
+    std::erase_if( _rects, []( auto& rect ) { return rect.width == 0 || rect.height == 0; } );
+}
+
+uint64_t damage_region::area() const
+{
+    uint64_t total = 0;
+    for( auto& rect : _rects ) total += aer::area( rect );
+    return total;
+}
+
+framebuffer_rect_t bounding_rect( std::span<const framebuffer_rect_t> rects )
+{
+    if( rects.empty() ) return {};
+    auto result = rects.front();
+    for( auto& rect : rects ) result = unite( result, rect );
+    return result;
+}
+
+} // namespace aer
@@ -0,0 +1,156 @@
+#include <Input/EventLoop.h>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+
+namespace aer
+{
+
+EventLoop::EventLoop()
+:   _epoll( epoll_create1( EPOLL_CLOEXEC ) ),
+    _interrupt( eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) )
+{
+    if( _epoll < 0 || _interrupt < 0 ) ABORT_F( "Failed to create event loop: %s", strerror( errno ) );
+
+    epoll_event event{ .events = EPOLLIN, .data = { .fd = _interrupt } };
+    epoll_ctl( _epoll, EPOLL_CTL_ADD, _interrupt, &event );
+}
+
+EventLoop::~EventLoop()
+{
+    for( auto& [fd, source] : _sources ) if( source->kind != source_kind::FD ) close( fd );
+    close( _interrupt );
+    close( _epoll );
+}
+
+int EventLoop::Add( int fd, uint32_t events, std::shared_ptr<source_t> source )
+{
+    epoll_event event{ .events = events, .data = { .fd = fd } };
+    if( epoll_ctl( _epoll, EPOLL_CTL_ADD, fd, &event ) != 0 )
+    {
+        LOG_F( ERROR, "Failed to watch fd %d: %s", fd, strerror( errno ) );
+        if( source->kind != source_kind::FD ) close( fd );
+        return -1;
+    }
+    _sources[fd] = std::move( source );
+    return fd;
+}
+
+int EventLoop::AddSource( int fd, uint32_t events, callback on_ready, pending has_pending )
+{
+    return Add( fd, events, std::make_shared<source_t>( source_kind::FD, std::move( on_ready ), std::move( has_pending ) ) );
+}
+
+int EventLoop::AddTimer( clock::duration interval, callback on_expire, bool repeat )
+{
+    const auto fd = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC );
+    if( fd < 0 ) { LOG_F( ERROR, "Failed to create timer: %s", strerror( errno ) ); return -1; }
+
+    const auto seconds = std::chrono::duration_cast<std::chrono::seconds>( interval );
+    const timespec period{ seconds.count(), std::chrono::duration_cast<std::chrono::nanoseconds>( interval - seconds ).count() };
+    const itimerspec spec{ .it_interval = repeat ? period : timespec{}, .it_value = period };
+    timerfd_settime( fd, 0, &spec, nullptr );
+
+    return Add( fd, EPOLLIN, std::make_shared<source_t>( source_kind::TIMER, std::move( on_expire ), pending{} ) );
+}
+
+int EventLoop::AddWakeup( callback on_wake )
+{
+    const auto fd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+    if( fd < 0 ) { LOG_F( ERROR, "Failed to create wakeup: %s", strerror( errno ) ); return -1; }
+
+    return Add( fd, EPOLLIN, std::make_shared<source_t>( source_kind::WAKEUP, std::move( on_wake ), pending{} ) );
+}
+
+void EventLoop::Signal( int wakeup )
+{
+    eventfd_write( wakeup, 1 );
+}
+
+void EventLoop::Interrupt()
+{
+    eventfd_write( _interrupt, 1 );
+}
+
+void EventLoop::Remove( int fd )
+{
+    auto itr = _sources.find( fd );
+    if( itr == _sources.end() ) return;
+
+    epoll_ctl( _epoll, EPOLL_CTL_DEL, fd, nullptr );
+    if( itr->second->kind != source_kind::FD ) close( fd );
+    _sources.erase( itr );
+}
+
+size_t EventLoop::Dispatch( std::optional<clock::duration> timeout )
+{
+    constexpr size_t max_ready = 32;
+
+    bool buffered = false;
+    for( auto& [fd, source] : _sources ) if( source->has_pending && source->has_pending() ) { buffered = true; break; }
+
+    // precise deadlines belong in timers; the wait timeout only needs to not fire early
+    const int timeout_ms = buffered ? 0
+                         : timeout ? static_cast<int>( std::chrono::ceil<std::chrono::milliseconds>( *timeout ).count() )
+                         : -1;
+
+    std::array<epoll_event, max_ready> ready;
+    int count = epoll_wait( _epoll, ready.data(), ready.size(), timeout_ms );
+    if( count < 0 )
+    {
+        if( errno != EINTR ) LOG_F( ERROR, "epoll_wait failed: %s", strerror( errno ) );
+        count = 0;
+    }
+
+    size_t dispatched = 0;
+    const auto run = [&]( int fd, uint32_t events )
+    {
+        auto itr = _sources.find( fd );
+        if( itr == _sources.end() ) return;
+
+        // keep the source alive in case its callback removes it
+        auto source = itr->second;
+        if( source->kind != source_kind::FD )
+        {
+            uint64_t value = 0;
+            if( read( fd, &value, sizeof( value ) ) != sizeof( value ) ) return;
+            events = static_cast<uint32_t>( value );
+        }
+        source->on_ready( events );
+        ++dispatched;
+    };
+
+    for( int i = 0; i < count; ++i )
+    {
+        if( ready[i].data.fd == _interrupt ) { eventfd_t value; eventfd_read( _interrupt, &value ); }
+        else run( ready[i].data.fd, ready[i].events );
+    }
+
+    if( buffered )
+    {
+        const auto was_ready = [&]( int fd )
+        {
+            for( int i = 0; i < count; ++i ) if( ready[i].data.fd == fd ) return true;
+            return false;
+        };
+
+        std::array<int, max_ready> pending_fds;
+        size_t pending_count = 0;
+        for( auto& [fd, source] : _sources )
+        {
+            if( pending_count == max_ready ) break;
+            if( source->has_pending && !was_ready( fd ) && source->has_pending() ) pending_fds[pending_count++] = fd;
+        }
+        for( size_t i = 0; i < pending_count; ++i ) run( pending_fds[i], EPOLLIN );
+    }
+
+    return dispatched;
+}
+
+} // namespace aer
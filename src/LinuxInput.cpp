@@ -0,0 +1,396 @@
+#include <Input/LinuxInput.h>
+
+#include <Input/EventPool.h>
+#include <Input/MouseCodes.h>
+#include <Input/PointerEvents.h>
+
+#include <Events/KeyEvents.h>
+#include <Events/MouseEvents.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <X11/keysym.h>
+
+// last: its KEY_* and BTN_* macros would otherwise rewrite aer's key names
+#include <linux/input.h>
+
+namespace aer
+{
+
+namespace
+{
+    // X keycodes are evdev codes offset by 8
+    constexpr uint32_t keycode_offset = 8;
+    // one wheel detent in REL_WHEEL_HI_RES units
+    constexpr double hires_detent = 120.0;
+
+    struct key_entry_t
+    {
+        uint16_t    code;
+        key::symbol base;
+        key::symbol shifted;
+    };
+
+    // keysyms of a US layout, enough for kiosk keyboards; a real layout can be passed instead
+    constexpr key_entry_t us_layout[]
+    {
+        { KEY_ESC, XK_Escape, XK_Escape },
+        { KEY_1, '1', '!' }, { KEY_2, '2', '@' }, { KEY_3, '3', '#' }, { KEY_4, '4', '$' }, { KEY_5, '5', '%' },
+        { KEY_6, '6', '^' }, { KEY_7, '7', '&' }, { KEY_8, '8', '*' }, { KEY_9, '9', '(' }, { KEY_0, '0', ')' },
+        { KEY_MINUS, '-', '_' }, { KEY_EQUAL, '=', '+' }, { KEY_BACKSPACE, XK_BackSpace, XK_BackSpace }, { KEY_TAB, XK_Tab, XK_ISO_Left_Tab },
+        { KEY_Q, 'q', 'Q' }, { KEY_W, 'w', 'W' }, { KEY_E, 'e', 'E' }, { KEY_R, 'r', 'R' }, { KEY_T, 't', 'T' },
+        { KEY_Y, 'y', 'Y' }, { KEY_U, 'u', 'U' }, { KEY_I, 'i', 'I' }, { KEY_O, 'o', 'O' }, { KEY_P, 'p', 'P' },
+        { KEY_LEFTBRACE, '[', '{' }, { KEY_RIGHTBRACE, ']', '}' }, { KEY_ENTER, XK_Return, XK_Return }, { KEY_LEFTCTRL, XK_Control_L, XK_Control_L },
+        { KEY_A, 'a', 'A' }, { KEY_S, 's', 'S' }, { KEY_D, 'd', 'D' }, { KEY_F, 'f', 'F' }, { KEY_G, 'g', 'G' },
+        { KEY_H, 'h', 'H' }, { KEY_J, 'j', 'J' }, { KEY_K, 'k', 'K' }, { KEY_L, 'l', 'L' },
+        { KEY_SEMICOLON, ';', ':' }, { KEY_APOSTROPHE, '\'', '"' }, { KEY_GRAVE, '`', '~' },
+        { KEY_LEFTSHIFT, XK_Shift_L, XK_Shift_L }, { KEY_BACKSLASH, '\\', '|' },
+        { KEY_Z, 'z', 'Z' }, { KEY_X, 'x', 'X' }, { KEY_C, 'c', 'C' }, { KEY_V, 'v', 'V' }, { KEY_B, 'b', 'B' },
+        { KEY_N, 'n', 'N' }, { KEY_M, 'm', 'M' }, { KEY_COMMA, ',', '<' }, { KEY_DOT, '.', '>' }, { KEY_SLASH, '/', '?' },
+        { KEY_RIGHTSHIFT, XK_Shift_R, XK_Shift_R }, { KEY_LEFTALT, XK_Alt_L, XK_Alt_L }, { KEY_SPACE, ' ', ' ' }, { KEY_CAPSLOCK, XK_Caps_Lock, XK_Caps_Lock },
+        { KEY_F1, XK_F1, XK_F1 }, { KEY_F2, XK_F2, XK_F2 }, { KEY_F3, XK_F3, XK_F3 }, { KEY_F4, XK_F4, XK_F4 },
+        { KEY_F5, XK_F5, XK_F5 }, { KEY_F6, XK_F6, XK_F6 }, { KEY_F7, XK_F7, XK_F7 }, { KEY_F8, XK_F8, XK_F8 },
+        { KEY_F9, XK_F9, XK_F9 }, { KEY_F10, XK_F10, XK_F10 }, { KEY_F11, XK_F11, XK_F11 }, { KEY_F12, XK_F12, XK_F12 },
+        { KEY_NUMLOCK, XK_Num_Lock, XK_Num_Lock }, { KEY_SCROLLLOCK, XK_Scroll_Lock, XK_Scroll_Lock },
+        { KEY_KP7, XK_KP_Home, XK_KP_7 }, { KEY_KP8, XK_KP_Up, XK_KP_8 }, { KEY_KP9, XK_KP_Page_Up, XK_KP_9 }, { KEY_KPMINUS, XK_KP_Subtract, XK_KP_Subtract },
+        { KEY_KP4, XK_KP_Left, XK_KP_4 }, { KEY_KP5, XK_KP_Begin, XK_KP_5 }, { KEY_KP6, XK_KP_Right, XK_KP_6 }, { KEY_KPPLUS, XK_KP_Add, XK_KP_Add },
+        { KEY_KP1, XK_KP_End, XK_KP_1 }, { KEY_KP2, XK_KP_Down, XK_KP_2 }, { KEY_KP3, XK_KP_Page_Down, XK_KP_3 }, { KEY_KP0, XK_KP_Insert, XK_KP_0 },
+        { KEY_KPDOT, XK_KP_Delete, XK_KP_Decimal }, { KEY_KPENTER, XK_KP_Enter, XK_KP_Enter }, { KEY_KPSLASH, XK_KP_Divide, XK_KP_Divide }, { KEY_KPASTERISK, XK_KP_Multiply, XK_KP_Multiply },
+        { KEY_RIGHTCTRL, XK_Control_R, XK_Control_R }, { KEY_SYSRQ, XK_Print, XK_Print }, { KEY_RIGHTALT, XK_Alt_R, XK_Alt_R },
+        { KEY_HOME, XK_Home, XK_Home }, { KEY_UP, XK_Up, XK_Up }, { KEY_PAGEUP, XK_Page_Up, XK_Page_Up }, { KEY_LEFT, XK_Left, XK_Left },
+        { KEY_RIGHT, XK_Right, XK_Right }, { KEY_END, XK_End, XK_End }, { KEY_DOWN, XK_Down, XK_Down }, { KEY_PAGEDOWN, XK_Page_Down, XK_Page_Down },
+        { KEY_INSERT, XK_Insert, XK_Insert }, { KEY_DELETE, XK_Delete, XK_Delete }, { KEY_PAUSE, XK_Pause, XK_Pause },
+        { KEY_LEFTMETA, XK_Super_L, XK_Super_L }, { KEY_RIGHTMETA, XK_Super_R, XK_Super_R }, { KEY_COMPOSE, XK_Menu, XK_Menu }
+    };
+
+    keycode_map::code_map us_keymap()
+    {
+        keycode_map::code_map codes{};
+        for( auto& entry : us_layout ) codes[entry.code + keycode_offset] = { entry.base, entry.shifted };
+        return codes;
+    }
+
+    mouse_button to_button( uint16_t code )
+    {
+        switch( code )
+        {
+            case BTN_LEFT:
+            case BTN_TOUCH:     return MOUSE_Left;
+            case BTN_MIDDLE:    return MOUSE_Middle;
+            case BTN_RIGHT:     return MOUSE_Right;
+            case BTN_SIDE:      return MOUSE_Backward;
+            case BTN_EXTRA:     return MOUSE_Forward;
+            default:            return MOUSE_None;
+        }
+    }
+
+    // kernel time: CLOCK_MONOTONIC once EVIOCSCLOCKID succeeds, which is what steady_clock reads
+    input_clock::time_point to_time_point( const input_event& event )
+    {
+        const auto since_epoch = std::chrono::seconds( event.input_event_sec ) + std::chrono::microseconds( event.input_event_usec );
+        return input_clock::time_point( std::chrono::duration_cast<input_clock::duration>( since_epoch ) );
+    }
+}
+
+LinuxInput::LinuxInput( Window* window, std::optional<keycode_map::code_map> keymap )
+:   _window( window ),
+    _keymap( keymap ? *keymap : us_keymap() ),
+    _epoll( epoll_create1( EPOLL_CLOEXEC ) )
+{
+    if( _epoll < 0 ) ABORT_F( "Failed to create evdev epoll: %s", strerror( errno ) );
+}
+
+LinuxInput::~LinuxInput()
+{
+    for( auto& [fd, device] : _devices ) if( device.owned ) close( fd );
+    close( _epoll );
+}
+
+size_t LinuxInput::OpenDevices( const std::string& directory, bool grab )
+{
+    size_t opened = 0;
+    std::error_code error;
+    for( auto& entry : std::filesystem::directory_iterator( directory, error ) )
+    {
+        if( entry.path().filename().string().starts_with( "event" ) && Open( entry.path(), grab ) >= 0 ) ++opened;
+    }
+    LOG_IF_F( WARNING, opened == 0, "No readable evdev devices in %s", directory.c_str() );
+    return opened;
+}
+
+int LinuxInput::Open( const std::string& path, bool grab )
+{
+    const int fd = open( path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC );
+    if( fd < 0 )
+    {
+        LOG_F( INFO, "Skipping %s: %s", path.c_str(), strerror( errno ) );
+        return -1;
+    }
+    if( grab && ioctl( fd, EVIOCGRAB, 1 ) != 0 ) LOG_F( WARNING, "Failed to grab %s: %s", path.c_str(), strerror( errno ) );
+    return AddDevice( fd, true );
+}
+
+int LinuxInput::AddDevice( int fd, bool owned )
+{
+    device_t device;
+    device.fd    = fd;
+    device.owned = owned;
+
+    // these only work on real device nodes; a pipe keeps whatever times and coordinates it carries
+    const int clock_id = CLOCK_MONOTONIC;
+    ioctl( fd, EVIOCSCLOCKID, &clock_id );
+    input_absinfo info{};
+    if( ioctl( fd, EVIOCGABS( ABS_X ), &info ) == 0 ) device.abs_x = { info.minimum, info.maximum };
+    if( ioctl( fd, EVIOCGABS( ABS_Y ), &info ) == 0 ) device.abs_y = { info.minimum, info.maximum };
+
+    epoll_event event{ .events = EPOLLIN, .data = { .fd = fd } };
+    if( epoll_ctl( _epoll, EPOLL_CTL_ADD, fd, &event ) != 0 )
+    {
+        LOG_F( ERROR, "Failed to watch evdev fd %d: %s", fd, strerror( errno ) );
+        if( owned ) close( fd );
+        return -1;
+    }
+    _devices[fd] = std::move( device );
+    return fd;
+}
+
+void LinuxInput::RemoveDevice( int fd )
+{
+    auto itr = _devices.find( fd );
+    if( itr == _devices.end() ) return;
+
+    epoll_ctl( _epoll, EPOLL_CTL_DEL, fd, nullptr );
+    if( itr->second.owned ) close( fd );
+    _devices.erase( itr );
+}
+
+bool LinuxInput::WaitEvents( Events& events, std::optional<clock::duration> timeout )
+{
+    pollfd descriptor{ .fd = _epoll, .events = POLLIN, .revents = 0 };
+    const auto deadline = timeout ? std::optional( clock::now() + *timeout ) : std::nullopt;
+    while( true )
+    {
+        // a signal cuts the wait short; go back to sleep for whatever is left of it
+        const auto remaining = deadline ? std::max( *deadline - clock::now(), clock::duration::zero() ) : clock::duration::zero();
+        const int timeout_ms = deadline ? static_cast<int>( std::chrono::ceil<std::chrono::milliseconds>( remaining ).count() ) : -1;
+        const int ready = poll( &descriptor, 1, timeout_ms );
+        if( ready > 0 ) break;
+        if( ready == 0 ) return false;
+        if( errno != EINTR )
+        {
+            LOG_F( ERROR, "Failed to wait for evdev input: %s", strerror( errno ) );
+            return false;
+        }
+    }
+    return PollEvents( events );
+}
+
+bool LinuxInput::PollEvents( Events& events )
+{
+    const auto appended = events.size();
+    constexpr int max_ready = 16;
+    std::array<epoll_event, max_ready> ready;
+
+    // finished devices stay until their last frame has been translated
+    std::vector<int> finished;
+    int count;
+    while( ( count = epoll_wait( _epoll, ready.data(), max_ready, 0 ) ) > 0 )
+    {
+        for( int i = 0; i < count; ++i )
+        {
+            auto itr = _devices.find( ready[i].data.fd );
+            if( itr != _devices.end() && !ReadDevice( itr->second ) ) finished.push_back( itr->first );
+        }
+        if( count < max_ready ) break;
+    }
+
+    _ring.consume( [this]( const evdev_event_t& event ) { Translate( event ); } );
+    for( auto fd : finished ) RemoveDevice( fd );
+    events.splice( events.end(), _events );
+    return events.size() != appended;
+}
+
+bool LinuxInput::PollEvents( typed_events_t& events )
+{
+    const auto appended = events.size();
+    Events untyped;
+    _typed_events = &events;
+    PollEvents( untyped );
+    _typed_events = nullptr;
+    return events.size() != appended;
+}
+
+bool LinuxInput::ReadDevice( device_t& device )
+{
+    constexpr size_t batch = 64;
+    alignas( input_event ) std::array<std::byte, batch * sizeof( input_event )> buffer;
+
+    while( true )
+    {
+        // a pipe may split a record across writes; carry the head of it into the next read
+        const size_t carried = device.partial.size();
+        std::copy( device.partial.begin(), device.partial.end(), buffer.begin() );
+        device.partial.clear();
+
+        const auto result = ::read( device.fd, buffer.data() + carried, buffer.size() - carried );
+        if( result <= 0 )
+        {
+            device.partial.assign( buffer.begin(), buffer.begin() + carried );
+            if( result < 0 && errno == EINTR ) continue;
+            if( result < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK ) ) return true;
+
+            // end of a recorded stream, or the device went away; stop watching it right away
+            // so a hung up fd does not keep the poll loop busy
+            epoll_ctl( _epoll, EPOLL_CTL_DEL, device.fd, nullptr );
+            return false;
+        }
+
+        const size_t available = carried + static_cast<size_t>( result );
+        const size_t records   = available / sizeof( input_event );
+        for( size_t i = 0; i < records; ++i )
+        {
+            input_event event;
+            std::memcpy( &event, buffer.data() + i * sizeof( input_event ), sizeof( event ) );
+
+            const evdev_event_t entry{ to_time_point( event ), device.fd, event.type, event.code, event.value };
+            if( !_ring.push( entry ) )
+            {
+                _ring.consume( [this]( const evdev_event_t& queued ) { Translate( queued ); } );
+                _ring.push( entry );
+            }
+        }
+        device.partial.assign( buffer.begin() + records * sizeof( input_event ), buffer.begin() + available );
+        if( available < buffer.size() ) return true;
+    }
+}
+
+template<typename E, typename... Args>
+void LinuxInput::Emit( clock::time_point time, Args&&... args )
+{
+    if( _typed_events ) return event_record<E>::append( *_typed_events, time, std::forward<Args>( args )... );
+    _events.emplace_back( new( *_event_pool ) pooled<timestamped<E>>( time, _window, std::forward<Args>( args )... ) );
+}
+
+void LinuxInput::Translate( const evdev_event_t& event )
+{
+    auto itr = _devices.find( event.fd );
+    if( itr == _devices.end() ) return;
+    auto& device = itr->second;
+
+    if( event.type == EV_SYN )
+    {
+        // after an overflow everything up to and including the next report is incomplete
+        if( event.code == SYN_DROPPED ) device.dropped = true;
+        if( event.code != SYN_REPORT ) return;
+        if( !std::exchange( device.dropped, false ) ) EndFrame( device, event.time );
+
+        device.dx = device.dy = 0;
+        device.abs_position_x.reset();
+        device.abs_position_y.reset();
+        device.wheel = device.hwheel = device.hires = device.hhires = 0;
+        device.buttons.clear();
+        return;
+    }
+    if( device.dropped ) return;
+
+    switch( event.type )
+    {
+        case EV_REL:
+        {
+            switch( event.code )
+            {
+                case REL_X:             device.dx += event.value; break;
+                case REL_Y:             device.dy += event.value; break;
+                case REL_WHEEL:         device.wheel += event.value; break;
+                case REL_HWHEEL:        device.hwheel += event.value; break;
+                case REL_WHEEL_HI_RES:  device.hires += event.value; device.hires_wheel = true; break;
+                case REL_HWHEEL_HI_RES: device.hhires += event.value; device.hires_wheel = true; break;
+                default: break;
+            }
+            break;
+        }
+        case EV_ABS:
+        {
+            if( event.code == ABS_X ) device.abs_position_x = event.value;
+            if( event.code == ABS_Y ) device.abs_position_y = event.value;
+            break;
+        }
+        case EV_KEY: device.buttons.push_back( event ); break;
+        default: break;
+    }
+}
+
+void LinuxInput::EndFrame( device_t& device, clock::time_point time )
+{
+    const auto scale = []( int32_t value, const axis_t& axis, uint32_t extent )
+    {
+        if( axis.maximum <= axis.minimum || extent == 0 ) return static_cast<double>( value );
+        return static_cast<double>( value - axis.minimum ) * extent / ( static_cast<double>( axis.maximum ) - axis.minimum + 1 );
+    };
+
+    const auto previous_x = static_cast<int32_t>( std::floor( _x ) );
+    const auto previous_y = static_cast<int32_t>( std::floor( _y ) );
+    _x = device.abs_position_x ? scale( *device.abs_position_x, device.abs_x, _width ) : _x + device.dx;
+    _y = device.abs_position_y ? scale( *device.abs_position_y, device.abs_y, _height ) : _y + device.dy;
+    if( _width )  _x = std::clamp( _x, 0.0, _width - 1.0 );
+    if( _height ) _y = std::clamp( _y, 0.0, _height - 1.0 );
+
+    const auto x = static_cast<int32_t>( std::floor( _x ) );
+    const auto y = static_cast<int32_t>( std::floor( _y ) );
+    if( device.dx != 0 || device.dy != 0 ) Emit<MouseRawMotionEvent>( time, device.dx, device.dy );
+    if( x != previous_x || y != previous_y ) Emit<MouseMoveEvent>( time, x, y );
+
+    if( _smooth_scroll )
+    {
+        const double dx = device.hires_wheel ? device.hhires / hires_detent : device.hwheel;
+        const double dy = device.hires_wheel ? device.hires / hires_detent : device.wheel;
+        if( dx != 0 || dy != 0 ) Emit<MouseSmoothScrollEvent>( time, x, y, dx, dy );
+    }
+    else for( int32_t i = 0; i < std::abs( device.wheel ); ++i ) Emit<MouseScrollEvent>( time, x, y, device.wheel > 0 ? 1 : -1 );
+
+    for( auto& change : device.buttons ) KeyChange( change );
+}
+
+void LinuxInput::KeyChange( const evdev_event_t& event )
+{
+    if( const auto button = to_button( event.code ); button != MOUSE_None )
+    {
+        const auto x = static_cast<int32_t>( std::floor( _x ) );
+        const auto y = static_cast<int32_t>( std::floor( _y ) );
+        if( event.value == 1 ) Emit<MouseDownEvent>( event.time, x, y, button );
+        if( event.value == 0 ) Emit<MouseUpEvent>( event.time, x, y, button );
+        return;
+    }
+
+    // X keycodes are a single byte, which also leaves out the remaining button ranges
+    if( event.code + keycode_offset >= keycode_map::num_keycodes ) return;
+
+    // value 2 is autorepeat, which X reports as another press
+    const auto keycode      = static_cast<uint8_t>( event.code + keycode_offset );
+    const bool pressed      = event.value != 0;
+    const auto key          = _keymap.symbol( keycode );
+    const auto state        = static_cast<uint16_t>( _modifiers | _locks );
+    const auto modified_key = _keymap.symbol( keycode, state );
+    const auto mod          = _keymap.mod( key, state, pressed );
+    if( pressed ) Emit<KeyDownEvent>( event.time, key, modified_key, mod );
+    else Emit<KeyUpEvent>( event.time, key, modified_key, mod );
+
+    // locks are kept apart so releasing a held modifier never clears one
+    if( event.value == 2 ) return;
+    _modifiers = _keymap.mod( key, _modifiers, pressed );
+    if( event.value == 1 && key == XK_Caps_Lock ) _locks ^= MODIFIER_LOCK;
+    if( event.value == 1 && key == XK_Num_Lock )  _locks ^= MODIFIER_2;
+}
+
+} // namespace aer
@@ -0,0 +1,455 @@
+#include <Graphics/XCBConnection.h>
+
+#include <mutex>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace aer::xcb
+{
+
+template<typename T>
+const T* event_cast( const xcb_generic_event_t* event ) { return reinterpret_cast<const T*>( event ); }
+
+xcb_window_t event_window( const xcb_generic_event_t* event, uint8_t xinput_opcode )
+{
+    switch( event->response_type & ~SERVER_USER_MASK )
+    {
+        case XCB_KEY_PRESS:
+        case XCB_KEY_RELEASE:       return event_cast<xcb_key_press_event_t>( event )->event;
+        case XCB_BUTTON_PRESS:
+        case XCB_BUTTON_RELEASE:    return event_cast<xcb_button_press_event_t>( event )->event;
+        case XCB_MOTION_NOTIFY:     return event_cast<xcb_motion_notify_event_t>( event )->event;
+        case XCB_ENTER_NOTIFY:
+        case XCB_LEAVE_NOTIFY:      return event_cast<xcb_enter_notify_event_t>( event )->event;
+        case XCB_FOCUS_IN:
+        case XCB_FOCUS_OUT:         return event_cast<xcb_focus_in_event_t>( event )->event;
+        case XCB_EXPOSE:            return event_cast<xcb_expose_event_t>( event )->window;
+        case XCB_DESTROY_NOTIFY:    return event_cast<xcb_destroy_notify_event_t>( event )->window;
+        case XCB_UNMAP_NOTIFY:      return event_cast<xcb_unmap_notify_event_t>( event )->window;
+        case XCB_MAP_NOTIFY:        return event_cast<xcb_map_notify_event_t>( event )->window;
+        case XCB_REPARENT_NOTIFY:   return event_cast<xcb_reparent_notify_event_t>( event )->window;
+        case XCB_CONFIGURE_NOTIFY:  return event_cast<xcb_configure_notify_event_t>( event )->window;
+        case XCB_GRAVITY_NOTIFY:    return event_cast<xcb_gravity_notify_event_t>( event )->window;
+        case XCB_PROPERTY_NOTIFY:   return event_cast<xcb_property_notify_event_t>( event )->window;
+        case XCB_SELECTION_CLEAR:   return event_cast<xcb_selection_clear_event_t>( event )->owner;
+        case XCB_SELECTION_REQUEST: return event_cast<xcb_selection_request_event_t>( event )->owner;
+        case XCB_SELECTION_NOTIFY:  return event_cast<xcb_selection_notify_event_t>( event )->requestor;
+        case XCB_CLIENT_MESSAGE:    return event_cast<xcb_client_message_event_t>( event )->window;
+        case XCB_GE_GENERIC:
+        {
+            auto generic = event_cast<xcb_ge_generic_event_t>( event );
+            if( xinput_opcode == 0 || generic->extension != xinput_opcode ) return 0;
+            switch( generic->event_type )
+            {
+                case XCB_INPUT_KEY_PRESS:
+                case XCB_INPUT_KEY_RELEASE:
+                case XCB_INPUT_BUTTON_PRESS:
+                case XCB_INPUT_BUTTON_RELEASE:
+                case XCB_INPUT_MOTION:      return event_cast<xcb_input_button_press_event_t>( event )->event;
+                case XCB_INPUT_ENTER:
+                case XCB_INPUT_LEAVE:
+                case XCB_INPUT_FOCUS_IN:
+                case XCB_INPUT_FOCUS_OUT:   return event_cast<xcb_input_enter_event_t>( event )->event;
+                default:                    return 0;
+            }
+        }
+        default:                    return 0;
+    }
+}
+
+std::optional<xcb_timestamp_t> event_timestamp( const xcb_generic_event_t* event, uint8_t xinput_opcode )
+{
+    switch( event->response_type & ~SERVER_USER_MASK )
+    {
+        case XCB_KEY_PRESS:
+        case XCB_KEY_RELEASE:       return event_cast<xcb_key_press_event_t>( event )->time;
+        case XCB_BUTTON_PRESS:
+        case XCB_BUTTON_RELEASE:    return event_cast<xcb_button_press_event_t>( event )->time;
+        case XCB_MOTION_NOTIFY:     return event_cast<xcb_motion_notify_event_t>( event )->time;
+        case XCB_ENTER_NOTIFY:
+        case XCB_LEAVE_NOTIFY:      return event_cast<xcb_enter_notify_event_t>( event )->time;
+        case XCB_PROPERTY_NOTIFY:   return event_cast<xcb_property_notify_event_t>( event )->time;
+        case XCB_SELECTION_CLEAR:   return event_cast<xcb_selection_clear_event_t>( event )->time;
+        case XCB_SELECTION_REQUEST: return event_cast<xcb_selection_request_event_t>( event )->time;
+        case XCB_SELECTION_NOTIFY:  return event_cast<xcb_selection_notify_event_t>( event )->time;
+        case XCB_GE_GENERIC:
+        {
+            // every XI2 event carries its time at the same offset
+            if( xinput_opcode == 0 || event_cast<xcb_ge_generic_event_t>( event )->extension != xinput_opcode ) return std::nullopt;
+            return event_cast<xcb_input_raw_button_press_event_t>( event )->time;
+        }
+        default:                    return std::nullopt;
+    }
+}
+
+} // namespace aer::xcb
+
+namespace aer
+{
+using namespace aer::xcb;
+
+namespace
+{
+    std::mutex                              registry_mutex;
+    std::vector<ref_ptr<XCBConnection>>     registry;
+}
+
+ref_ptr<XCBConnection> XCBConnection::Open( const std::string& display_name, int* screen_num )
+{
+    std::scoped_lock lock( registry_mutex );
+    // a connection the server dropped stays with whoever still holds it; later opens get a new one
+    std::erase_if( registry, []( auto& shared ) { return shared->_owned && xcb_connection_has_error( shared->_connection ) != 0; } );
+    for( auto& shared : registry ) if( shared->_owned && shared->_display_name == display_name )
+    {
+        if( screen_num ) *screen_num = shared->_default_screen;
+        return shared;
+    }
+
+    int default_screen = 0;
+    auto connection = xcb_connect( display_name.empty() ? nullptr : display_name.c_str(), &default_screen );
+    if( xcb_connection_has_error( connection ) != 0 )
+    {
+        xcb_disconnect( connection );
+        ABORT_F( "Failed to establish xcb connection" );
+    }
+
+    if( screen_num ) *screen_num = default_screen;
+    auto shared = ref_ptr<XCBConnection>( new XCBConnection( connection, display_name, true ) );
+    shared->_default_screen = default_screen;
+    registry.push_back( shared );
+    return shared;
+}
+
+ref_ptr<XCBConnection> XCBConnection::Adopt( xcb_connection_t* connection )
+{
+    if( xcb_connection_has_error( connection ) != 0 ) ABORT_F( "Supplied xcb connection has an error" );
+
+    std::scoped_lock lock( registry_mutex );
+    for( auto& shared : registry ) if( shared->_connection == connection ) return shared;
+
+    auto shared = ref_ptr<XCBConnection>( new XCBConnection( connection, {}, false ) );
+    registry.push_back( shared );
+    return shared;
+}
+
+ref_ptr<XCBConnection> XCBConnection::Offline( const keyboard_map::code_map& keymap, ref_ptr<xinput> xinput )
+{
+    return ref_ptr<XCBConnection>( new XCBConnection( keymap, std::move( xinput ) ) );
+}
+
+XCBConnection::XCBConnection( xcb_connection_t* connection, std::string display_name, bool owned )
+:   _connection( connection ),
+    _setup( xcb_get_setup( connection ) ),
+    _display_name( std::move( display_name ) ),
+    _owned( owned ),
+    _atoms( new atom_cache( connection ) ),
+    _keymap( new keyboard_map( connection ) )
+{}
+
+XCBConnection::XCBConnection( const keyboard_map::code_map& keymap, ref_ptr<xinput> xinput )
+:   _owned( false ),
+    _keymap( new keyboard_map( keymap ) ),
+    _xinput( std::move( xinput ) )
+{}
+
+XCBConnection::~XCBConnection()
+{
+    SetThreadedInput( false );
+    free( _queued_event );
+    for( auto& [window, queue] : _queues ) for( auto& queued : queue ) free( queued.event );
+    if( !_connection ) return;
+
+    if( _wake_window != 0 ) xcb_destroy_window( _connection, _wake_window );
+    xcb_flush( _connection );
+    if( _owned ) xcb_disconnect( _connection );
+}
+
+xcb_screen_t* XCBConnection::Screen( int screen_num ) const
+{
+    const auto screen_count = xcb_setup_roots_length( _setup );
+
+    LOG_IF_F( WARNING, screen_num >= screen_count, "Requested screen %d, only %d screens available", screen_num, screen_count );
+    if( screen_num >= screen_count ) screen_num = 0;
+    auto screen_iterator = xcb_setup_roots_iterator( _setup );
+    for( int i = 0; i < screen_num; ++i ) xcb_screen_next( &screen_iterator );
+    return screen_iterator.data;
+}
+
+xinput& XCBConnection::XInput()
+{
+    if( !_xinput ) _xinput = ref_ptr<xinput>( _connection ? new xinput( _connection ) : new xinput( 0, {} ) );
+    return *_xinput.get();
+}
+
+bool XCBConnection::HasPresent()
+{
+    if( _present ) return *_present;
+    _present = false;
+    if( !_connection ) return false;
+
+    round_trip_count.fetch_add( 1, std::memory_order_relaxed );
+    auto extension = xcb_get_extension_data( _connection, &xcb_present_id );
+    if( !extension || !extension->present ) return false;
+
+    // Present events need the version announced before the server will send them
+    free( wait_for_reply<xcb_present_query_version_reply_t>( _connection, xcb_present_query_version( _connection, 1, 0 ).sequence ) );
+    _present_opcode = extension->major_opcode;
+    _present        = true;
+    return true;
+}
+
+randr& XCBConnection::RandR()
+{
+    if( !_randr ) _randr = ref_ptr<randr>( new randr( _connection, _connection ? Screen( _default_screen )->root : XCB_NONE ) );
+    return *_randr.get();
+}
+
+void XCBConnection::SetRawInput( xcb_window_t window, bool enable )
+{
+    if( !enable && window != _raw_input_window ) return;
+    if( !_connection || !XInput().available() ) return;
+
+    const auto target = enable ? window : 0;
+    if( ( target == 0 ) != ( _raw_input_window == 0 ) )
+    {
+        xinput_select( _connection, Screen( _default_screen )->root, target ? XCB_INPUT_XI_EVENT_MASK_RAW_MOTION : 0 );
+        xcb_flush( _connection );
+    }
+    _raw_input_window = target;
+}
+
+XCBConnection::event_queue& XCBConnection::Register( xcb_window_t window )
+{
+    return _queues[window];
+}
+
+void XCBConnection::Unregister( xcb_window_t window )
+{
+    if( auto itr = _queues.find( window ); itr != _queues.end() )
+    {
+        for( auto& queued : itr->second ) free( queued.event );
+        _queues.erase( itr );
+    }
+    SetRawInput( window, false );
+    for( auto& [watched, watchers] : _property_watchers ) std::erase( watchers, window );
+    std::erase_if( _property_watchers, []( auto& watch ) { return watch.second.empty(); } );
+    if( !_queues.empty() || _owned ) return;
+
+    // the caller may disconnect an adopted connection once its last window is gone, and a
+    // new one could reuse the address; opened ones stay registered, see Open
+    std::scoped_lock lock( registry_mutex );
+    std::erase_if( registry, [this]( auto& shared ) { return shared.get() == this; } );
+}
+
+void XCBConnection::WatchProperties( xcb_window_t window, xcb_window_t watcher, bool enable )
+{
+    auto& watchers = _property_watchers[window];
+    if( enable ) watchers.push_back( watcher );
+    else if( auto itr = std::find( watchers.begin(), watchers.end(), watcher ); itr != watchers.end() ) watchers.erase( itr );
+
+    // our selection on another client's window is ours alone, so replacing it disturbs nobody;
+    // our own windows select property changes themselves while they need them
+    if( _connection && !_queues.contains( window ) && watchers.size() == ( enable ? 1u : 0u ) )
+    {
+        const uint32_t mask = enable ? XCB_EVENT_MASK_PROPERTY_CHANGE : XCB_EVENT_MASK_NO_EVENT;
+        xcb_change_window_attributes( _connection, window, XCB_CW_EVENT_MASK, &mask );
+    }
+    if( watchers.empty() ) _property_watchers.erase( window );
+}
+
+void XCBConnection::Route( const queued_event_t& queued )
+{
+    const auto event = queued.event;
+    switch( event->response_type & ~SERVER_USER_MASK )
+    {
+        case 0:
+        {
+            auto error = reinterpret_cast<xcb_generic_error_t*>( event );
+            LOG_F( WARNING, "X error %d on request %d.%d", error->error_code, error->major_code, error->minor_code );
+            break;
+        }
+        case XCB_MAPPING_NOTIFY:
+        {
+            auto mapping = reinterpret_cast<xcb_mapping_notify_event_t*>( event );
+            if( mapping->request == XCB_MAPPING_KEYBOARD ) _keymap->refresh( mapping->first_keycode, mapping->count );
+            break;
+        }
+        case XCB_GE_GENERIC:
+        {
+            auto generic = reinterpret_cast<xcb_ge_generic_event_t*>( event );
+            if( _present_opcode != 0 && generic->extension == _present_opcode )
+            {
+                // every Present event carries its window at the same offset
+                auto itr = _queues.find( reinterpret_cast<xcb_present_complete_notify_event_t*>( event )->window );
+                if( itr == _queues.end() ) break;
+                itr->second.push_back( queued );
+                return;
+            }
+            if( generic->extension != XInputOpcode() ) break;
+            if( generic->event_type == XCB_INPUT_DEVICE_CHANGED )
+            {
+                // applied once here for all windows; each still gets a copy in order with its
+                // input, so a trace records the new valuators and a replay can apply them
+                _xinput->update_device( reinterpret_cast<xcb_input_device_changed_event_t*>( event ) );
+                const auto size = sizeof( xcb_generic_event_t ) + 4 * size_t{ generic->length };
+                for( auto& [window, queue] : _queues )
+                {
+                    auto copy = static_cast<xcb_generic_event_t*>( malloc( size ) );
+                    std::memcpy( copy, event, size );
+                    queue.push_back( { copy, queued.received } );
+                }
+                break;
+            }
+
+            const auto window = generic->event_type == XCB_INPUT_RAW_MOTION ? _raw_input_window : event_window( event, XInputOpcode() );
+            auto itr = _queues.find( window );
+            if( itr == _queues.end() ) break;
+            itr->second.push_back( queued );
+            return;
+        }
+        case XCB_PROPERTY_NOTIFY:
+        {
+            // watchers get a copy, since each queue frees what it holds
+            const auto window = event_cast<xcb_property_notify_event_t>( event )->window;
+            if( auto watch = _property_watchers.find( window ); watch != _property_watchers.end() )
+            {
+                auto& watchers = watch->second;
+                for( auto current = watchers.begin(); current != watchers.end(); ++current )
+                {
+                    // one window serving several transfers to the same requestor is listed once per transfer
+                    const auto watcher = *current;
+                    auto itr = _queues.find( watcher );
+                    if( itr == _queues.end() || watcher == window || std::find( watchers.begin(), current, watcher ) != current ) continue;
+                    auto copy = static_cast<xcb_generic_event_t*>( malloc( sizeof( xcb_generic_event_t ) ) );
+                    std::memcpy( copy, event, sizeof( xcb_generic_event_t ) );
+                    itr->second.push_back( { copy, queued.received } );
+                }
+            }
+            auto itr = _queues.find( window );
+            if( itr == _queues.end() ) break;
+            itr->second.push_back( queued );
+            return;
+        }
+        default:
+        {
+            // a configuration change only marks the outputs stale; windows notice on their next poll
+            if( _randr && _randr->available() && ( event->response_type & ~SERVER_USER_MASK ) == _randr->first_event + XCB_RANDR_SCREEN_CHANGE_NOTIFY )
+            {
+                _randr->invalidate();
+                break;
+            }
+            auto itr = _queues.find( event_window( event ) );
+            if( itr == _queues.end() ) break;
+            itr->second.push_back( queued );
+            return;
+        }
+    }
+    free( event );
+}
+
+void XCBConnection::Dispatch()
+{
+    if( !_connection ) return;
+    if( _reader.joinable() ) _reader_ring.consume( [this]( const queued_event_t& queued ) { Route( queued ); } );
+    else
+    {
+        // one clock read per batch; everything here leaves libxcb within the same few microseconds
+        const auto received = std::chrono::steady_clock::now();
+        if( _queued_event ) Route( { std::exchange( _queued_event, nullptr ), received } );
+        while( auto event = xcb_poll_for_event( _connection ) ) Route( { event, received } );
+    }
+    // a mapping change requested rows during an earlier dispatch
+    _keymap->poll();
+}
+
+void XCBConnection::SetThreadedInput( bool enable )
+{
+    if( enable == _reader.joinable() || !_connection ) return;
+    if( enable )
+    {
+        if( _wake_window == 0 )
+        {
+            auto root = Screen( _default_screen )->root;
+            _wake_window = xcb_generate_id( _connection );
+            xcb_create_window( _connection, 0, _wake_window, root, 0, 0, 1, 1, 0, XCB_WINDOW_CLASS_INPUT_ONLY, XCB_COPY_FROM_PARENT, 0, nullptr );
+            xcb_flush( _connection );
+        }
+        // threaded dispatch never looks at the stash, and the reader only sees what comes after it
+        if( _queued_event ) Route( { std::exchange( _queued_event, nullptr ), std::chrono::steady_clock::now() } );
+        _reader_wake = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+        _reader = std::jthread( [this]( std::stop_token stop ) { ReaderLoop( stop ); } );
+        return;
+    }
+
+    // the reader sleeps inside xcb_wait_for_event, so poke it with an event of our own
+    _reader.request_stop();
+    xcb_client_message_event_t wake{};
+    wake.response_type = XCB_CLIENT_MESSAGE;
+    wake.format        = ATOM_SIZE_32;
+    wake.window        = _wake_window;
+    wake.type          = XCB_ATOM_NONE;
+    xcb_send_event( _connection, false, _wake_window, XCB_EVENT_MASK_NO_EVENT, reinterpret_cast<const char*>( &wake ) );
+    xcb_flush( _connection );
+    _reader.join();
+    close( std::exchange( _reader_wake, -1 ) );
+
+    // whatever the reader read but nobody polled yet still belongs to the windows
+    _reader_ring.consume( [this]( const queued_event_t& queued ) { Route( queued ); } );
+    if( _reader_leftover.event ) Route( std::exchange( _reader_leftover, {} ) );
+}
+
+void XCBConnection::ReaderLoop( std::stop_token stop )
+{
+    while( auto event = xcb_wait_for_event( _connection ) )
+    {
+        // only our own wake message is dropped; input read ahead of it still gets delivered
+        auto wake = reinterpret_cast<const xcb_client_message_event_t*>( event );
+        if( ( event->response_type & ~SERVER_USER_MASK ) == XCB_CLIENT_MESSAGE && wake->window == _wake_window )
+        {
+            free( event );
+            if( stop.stop_requested() ) break;
+            continue;
+        }
+
+        // a consumer that stopped polling cannot hold the reader up once a stop is requested;
+        // the event it could not hand over is routed after the join
+        const queued_event_t queued{ event, std::chrono::steady_clock::now() };
+        if( !_reader_ring.push_wait( queued, stop ) )
+        {
+            _reader_leftover = queued;
+            break;
+        }
+
+        // pairs with the fence in HasPendingEvents so a consumer about to sleep always gets woken
+        std::atomic_thread_fence( std::memory_order_seq_cst );
+        if( _reader_waiting.exchange( false ) ) eventfd_write( _reader_wake, 1 );
+    }
+}
+
+int XCBConnection::FileDescriptor() const
+{
+    if( !_connection ) return -1;
+    return _reader.joinable() ? _reader_wake : xcb_get_file_descriptor( _connection );
+}
+
+bool XCBConnection::HasPendingEvents()
+{
+    if( _reader.joinable() )
+    {
+        eventfd_t count;
+        eventfd_read( _reader_wake, &count );
+        _reader_waiting.store( true );
+        std::atomic_thread_fence( std::memory_order_seq_cst );
+        if( _reader_ring.empty() ) return false;
+        _reader_waiting.store( false );
+        return true;
+    }
+
+    // replies read by another thread can leave events queued in libxcb with nothing left on the socket
+    if( !_connection ) return false;
+    if( !_queued_event ) _queued_event = xcb_poll_for_queued_event( _connection );
+    return _queued_event != nullptr;
+}
+
+} // namespace aer
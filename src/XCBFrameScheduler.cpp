@@ -0,0 +1,89 @@
+#include <Graphics/XCBFrameScheduler.h>
+
+#include <algorithm>
+
+namespace aer::xcb
+{
+
+namespace
+{
+    // a UST further than this from the receipt time cannot be on our clock
+    constexpr auto same_clock_tolerance = std::chrono::seconds( 1 );
+    // weight of each new interval in the refresh estimate
+    constexpr int64_t period_smoothing = 8;
+    // an interval this far off the estimate is a jump of the counter, not a change of rate
+    constexpr int64_t period_tolerance = 2;
+}
+
+frame_scheduler::clock::time_point frame_scheduler::to_local( uint64_t ust, clock::time_point received )
+{
+    const auto server   = clock::time_point( std::chrono::microseconds( ust ) );
+    const auto observed = received - server;
+    if( !_ust_offset ) _ust_offset = std::chrono::abs( observed ) < same_clock_tolerance ? clock::duration::zero() : observed;
+    else if( *_ust_offset != clock::duration::zero() ) _ust_offset = std::min( *_ust_offset, observed );
+    return server + *_ust_offset;
+}
+
+void frame_scheduler::vblank( uint64_t ust, uint64_t msc, clock::time_point received )
+{
+    const auto time = to_local( ust, received );
+
+    // the counter restarts when the window moves to another crtc, and with it the timing
+    if( !_anchor_msc || msc < *_anchor_msc )
+    {
+        _period.reset();
+        _outliers = 0;
+    }
+    else if( msc > *_anchor_msc )
+    {
+        // a crtc switch or a fake vblank can also make the counter jump ahead or the time stand
+        // still. Such a sample only moves the anchor, so the period stays positive; a second
+        // outlier in a row is a new refresh rate and replaces the estimate
+        const auto measured = ( time - _anchor_time ) / static_cast<int64_t>( msc - *_anchor_msc );
+        const bool positive = measured > clock::duration::zero();
+        const bool outlier  = _period && ( measured > *_period * period_tolerance || measured * period_tolerance < *_period );
+        if( positive && !outlier )
+        {
+            _period   = _period ? *_period + ( measured - *_period ) / period_smoothing : measured;
+            _outliers = 0;
+        }
+        else if( positive && ++_outliers > 1 )
+        {
+            _period   = measured;
+            _outliers = 0;
+        }
+    }
+    else return;
+
+    _anchor_msc  = msc;
+    _anchor_time = time;
+}
+
+frame_scheduler::clock::time_point frame_scheduler::predict( uint64_t msc ) const
+{
+    if( !_anchor_msc ) return {};
+    return _anchor_time + refresh_interval() * ( static_cast<int64_t>( msc ) - static_cast<int64_t>( *_anchor_msc ) );
+}
+
+frame_target_t frame_scheduler::next_frame( clock::time_point now, clock::duration budget ) const
+{
+    if( !calibrated() ) return { _anchor_msc.value_or( 0 ) + 1, now, now };
+
+    // the earliest vblank after now + budget, but never one that has already been seen
+    const auto ahead = ( now + budget - _anchor_time ) / *_period;
+    const uint64_t msc = *_anchor_msc + static_cast<uint64_t>( std::max<int64_t>( ahead + 1, 1 ) );
+    const auto vblank  = predict( msc );
+    return { msc, vblank, vblank - budget };
+}
+
+uint64_t frame_scheduler::frame_done( const frame_target_t& target, clock::time_point now )
+{
+    ++_frames;
+    if( !calibrated() || now <= target.vblank ) return 0;
+
+    const auto missed = 1 + static_cast<uint64_t>( ( now - target.vblank ) / *_period );
+    _missed += missed;
+    return missed;
+}
+
+} // namespace aer::xcb
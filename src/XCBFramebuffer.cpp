@@ -0,0 +1,200 @@
+#include <Graphics/XCBFramebuffer.h>
+
+#include <xcb/bigreq.h>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+namespace aer
+{
+using namespace aer::xcb;
+
+XCBFramebuffer::XCBFramebuffer( ref_ptr<XCBConnection> display, xcb_drawable_t drawable, uint8_t depth,
+                                uint32_t width, uint32_t height, bool allow_shm )
+:   _display( std::move( display ) ),
+    _connection( _display->Native() ),
+    _drawable( drawable ),
+    _gc( xcb_generate_id( _connection ) ),
+    _depth( depth ),
+    _width( width ),
+    _height( height ),
+    _allow_shm( allow_shm )
+{
+    auto formats = xcb_setup_pixmap_formats( _display->Setup() );
+    auto format  = std::find_if( formats, formats + xcb_setup_pixmap_formats_length( _display->Setup() ),
+                                 [&]( auto& format ) { return format.depth == _depth; } );
+    if( format == formats + xcb_setup_pixmap_formats_length( _display->Setup() ) || format->bits_per_pixel != 32 )
+    {
+        ABORT_F( "Framebuffers need a 32 bits per pixel format for depth %d", _depth );
+    }
+
+    // both extension queries share the flush of the gc creation and are answered by the one
+    // wait inside the request length prefetch; the socket fallback then finds the length ready
+    xcb_create_gc( _connection, _gc, _drawable, 0, nullptr );
+    xcb_prefetch_extension_data( _connection, &xcb_big_requests_id );
+    if( _allow_shm ) xcb_prefetch_extension_data( _connection, &xcb_shm_id );
+    round_trip_count.fetch_add( 1, std::memory_order_relaxed );
+    xcb_prefetch_maximum_request_length( _connection );
+    if( _allow_shm )
+    {
+        auto extension = xcb_get_extension_data( _connection, &xcb_shm_id );
+        _allow_shm = extension && extension->present;
+        LOG_IF_F( INFO, !_allow_shm, "MIT-SHM unavailable, presenting framebuffers through the socket" );
+    }
+    Allocate();
+}
+
+XCBFramebuffer::~XCBFramebuffer()
+{
+    Release();
+    xcb_free_gc( _connection, _gc );
+    xcb_flush( _connection );
+}
+
+void XCBFramebuffer::Allocate()
+{
+    const size_t bytes = size_t{ _width } * _height * sizeof( uint32_t );
+    if( _allow_shm && bytes != 0 )
+    {
+        const int id = shmget( IPC_PRIVATE, bytes, IPC_CREAT | 0600 );
+        auto address = id >= 0 ? shmat( id, nullptr, 0 ) : reinterpret_cast<void*>( -1 );
+        if( address != reinterpret_cast<void*>( -1 ) )
+        {
+            // a remote server cannot see our segment, which only shows up as a failed attach
+            const auto segment = xcb_generate_id( _connection );
+            round_trip_count.fetch_add( 1, std::memory_order_relaxed );
+            auto error = xcb_request_check( _connection, xcb_shm_attach_checked( _connection, segment, id, false ) );
+
+            // marked for removal now, so the segment goes away with the last detach even if we crash
+            shmctl( id, IPC_RMID, nullptr );
+            if( !error )
+            {
+                _segment = segment;
+                _shared  = static_cast<uint32_t*>( address );
+                return;
+            }
+            free( error );
+            shmdt( address );
+        }
+        else if( id >= 0 ) shmctl( id, IPC_RMID, nullptr );
+
+        LOG_F( INFO, "MIT-SHM unavailable, presenting framebuffers through the socket" );
+        _allow_shm = false;
+    }
+    _local.assign( size_t{ _width } * _height, 0 );
+}
+
+void XCBFramebuffer::Release()
+{
+    WaitIdle();
+    if( _segment != 0 )
+    {
+        xcb_shm_detach( _connection, _segment );
+        shmdt( _shared );
+        _segment = 0;
+        _shared  = nullptr;
+    }
+    _local = {};
+}
+
+void XCBFramebuffer::WaitIdle()
+{
+    if( !_fence ) return;
+    free( wait_for_reply<xcb_get_input_focus_reply_t>( _connection, _fence->sequence ) );
+    _fence.reset();
+}
+
+std::span<uint32_t> XCBFramebuffer::Pixels()
+{
+    WaitIdle();
+    if( _shared ) return { _shared, size_t{ _width } * _height };
+    return _local;
+}
+
+void XCBFramebuffer::Resize( uint32_t width, uint32_t height )
+{
+    if( width == _width && height == _height ) return;
+    Release();
+    _width  = width;
+    _height = height;
+    Allocate();
+}
+
+void XCBFramebuffer::Present( std::span<const framebuffer_rect_t> dirty )
+{
+    const auto clip_and_put = [&]( const framebuffer_rect_t& rect )
+    {
+        const int64_t x0 = std::max<int64_t>( rect.x, 0 );
+        const int64_t y0 = std::max<int64_t>( rect.y, 0 );
+        const int64_t x1 = std::min<int64_t>( int64_t{ rect.x } + rect.width, _width );
+        const int64_t y1 = std::min<int64_t>( int64_t{ rect.y } + rect.height, _height );
+        if( x1 <= x0 || y1 <= y0 ) return;
+        PutImage( { static_cast<int32_t>( x0 ), static_cast<int32_t>( y0 ), static_cast<uint32_t>( x1 - x0 ), static_cast<uint32_t>( y1 - y0 ) } );
+    };
+
+    if( dirty.empty() ) clip_and_put( { 0, 0, _width, _height } );
+    for( auto& rect : dirty ) clip_and_put( rect );
+
+    // requests run in order, so once this reply arrives the server has read every upload above
+    if( _segment != 0 )
+    {
+        if( _fence ) xcb_discard_reply( _connection, _fence->sequence );
+        _fence = xcb_get_input_focus( _connection );
+    }
+    xcb_flush( _connection );
+}
+
+void XCBFramebuffer::PutImage( const framebuffer_rect_t& rect )
+{
+    if( _segment != 0 )
+    {
+        xcb_shm_put_image
+        (
+            _connection, _drawable, _gc, _width, _height,
+            rect.x, rect.y, rect.width, rect.height, rect.x, rect.y,
+            _depth, XCB_IMAGE_FORMAT_Z_PIXMAP, false, _segment, 0
+        );
+        return;
+    }
+
+    // split into requests that fit the server's limit: whole rows where possible, which are
+    // contiguous in the image and need no copy when the rect spans the full width
+    if( _max_request_bytes == 0 ) _max_request_bytes = size_t{ xcb_get_maximum_request_length( _connection ) } * 4;
+    const size_t payload = _max_request_bytes - sizeof( xcb_put_image_request_t );
+    const uint32_t columns = std::min<uint32_t>( rect.width, payload / sizeof( uint32_t ) );
+    const uint32_t rows    = std::max<uint32_t>( 1, payload / ( size_t{ columns } * sizeof( uint32_t ) ) );
+
+    for( uint32_t y = 0; y < rect.height; y += rows )
+    {
+        const uint32_t chunk_rows = std::min( rows, rect.height - y );
+        for( uint32_t x = 0; x < rect.width; x += columns )
+        {
+            const uint32_t chunk_columns = std::min( columns, rect.width - x );
+            const auto origin = &_local[size_t{ rect.y + y } * _width + rect.x + x];
+
+            const uint32_t* data = origin;
+            if( chunk_columns != _width )
+            {
+                _scratch.resize( size_t{ chunk_columns } * chunk_rows );
+                for( uint32_t row = 0; row < chunk_rows; ++row )
+                {
+                    std::memcpy( &_scratch[size_t{ row } * chunk_columns], origin + size_t{ row } * _width, chunk_columns * sizeof( uint32_t ) );
+                }
+                data = _scratch.data();
+            }
+
+            xcb_put_image
+            (
+                _connection, XCB_IMAGE_FORMAT_Z_PIXMAP, _drawable, _gc, chunk_columns, chunk_rows,
+                rect.x + x, rect.y + y, 0, _depth, chunk_columns * chunk_rows * sizeof( uint32_t ),
+                reinterpret_cast<const uint8_t*>( data )
+            );
+        }
+    }
+}
+
+} // namespace aer
@@ -0,0 +1,122 @@
+#include <Graphics/XCBRandR.h>
+#include <Graphics/XCBConnection.h>
+
+#include <algorithm>
+
+namespace aer::xcb
+{
+
+namespace
+{
+    // the vertical refresh of a mode in millihertz, counted the way xrandr does
+    uint32_t refresh_mhz( const xcb_randr_mode_info_t& mode )
+    {
+        uint64_t lines = mode.vtotal;
+        if( mode.mode_flags & XCB_RANDR_MODE_FLAG_DOUBLE_SCAN ) lines *= 2;
+        if( mode.mode_flags & XCB_RANDR_MODE_FLAG_INTERLACE ) lines /= 2;
+        const uint64_t dots = mode.htotal * lines;
+        return dots ? static_cast<uint32_t>( ( uint64_t{ mode.dot_clock } * 1000 + dots / 2 ) / dots ) : 0;
+    }
+}
+
+randr::randr( xcb_connection_t* connection, xcb_window_t root )
+:   _connection( connection ),
+    _root( root )
+{
+    if( !_connection ) return;
+
+    round_trip_count.fetch_add( 1, std::memory_order_relaxed );
+    auto extension = xcb_get_extension_data( _connection, &xcb_randr_id );
+    if( !extension || !extension->present ) return;
+
+    // 1.3 brings the cheap resource query, which does not make the server probe for monitors
+    auto version = wait_for_reply<xcb_randr_query_version_reply_t>( _connection, xcb_randr_query_version( _connection, 1, 3 ).sequence );
+    if( version && ( version->major_version > 1 || ( version->major_version == 1 && version->minor_version >= 3 ) ) )
+    {
+        first_event = extension->first_event;
+        xcb_randr_select_input( _connection, _root, XCB_RANDR_NOTIFY_MASK_SCREEN_CHANGE );
+    }
+    LOG_IF_F( INFO, first_event == 0, "RandR 1.3 unavailable, outputs cannot be told apart" );
+    free( version );
+}
+
+std::span<const output_t> randr::outputs()
+{
+    if( _stale ) refresh();
+    return _outputs;
+}
+
+const output_t* randr::find( std::string_view name )
+{
+    for( auto& output : outputs() ) if( name.empty() ? output.primary : output.name == name ) return &output;
+    // with no primary output set, the first lit one stands in for it
+    if( name.empty() && !_outputs.empty() ) return &_outputs.front();
+    return nullptr;
+}
+
+void randr::refresh()
+{
+    _stale = false;
+    _outputs.clear();
+    if( !available() ) return;
+
+    // three batches, each answered in one round-trip: the resources and the primary output,
+    // then every output, then the crtcs of those that are lit
+    const auto primary_cookie = xcb_randr_get_output_primary( _connection, _root );
+    auto resources = wait_for_reply<xcb_randr_get_screen_resources_current_reply_t>( _connection,
+                     xcb_randr_get_screen_resources_current( _connection, _root ).sequence );
+    auto primary   = wait_for_reply<xcb_randr_get_output_primary_reply_t>( _connection, primary_cookie.sequence );
+    const auto primary_output = primary ? primary->output : XCB_NONE;
+    free( primary );
+    if( !resources ) return;
+
+    const auto timestamp = resources->config_timestamp;
+    const auto ids   = std::span( xcb_randr_get_screen_resources_current_outputs( resources ),
+                                  xcb_randr_get_screen_resources_current_outputs_length( resources ) );
+    const auto modes = std::span( xcb_randr_get_screen_resources_current_modes( resources ),
+                                  xcb_randr_get_screen_resources_current_modes_length( resources ) );
+
+    std::vector<xcb_randr_get_output_info_cookie_t> output_cookies;
+    for( const auto id : ids ) output_cookies.push_back( xcb_randr_get_output_info( _connection, id, timestamp ) );
+
+    // outputs with a crtc are candidates until their crtc turns out to be showing a mode
+    std::vector<output_t> connected;
+    std::vector<xcb_randr_get_crtc_info_cookie_t> crtc_cookies;
+    for( size_t i = 0; i < ids.size(); ++i )
+    {
+        auto info = wait_for_reply<xcb_randr_get_output_info_reply_t>( _connection, output_cookies[i].sequence );
+        if( info && info->connection == XCB_RANDR_CONNECTION_CONNECTED && info->crtc != XCB_NONE )
+        {
+            output_t output;
+            output.name    = std::string( reinterpret_cast<const char*>( xcb_randr_get_output_info_name( info ) ),
+                                          xcb_randr_get_output_info_name_length( info ) );
+            output.primary = ids[i] == primary_output;
+            output.id      = ids[i];
+            output.crtc    = info->crtc;
+            connected.push_back( std::move( output ) );
+            crtc_cookies.push_back( xcb_randr_get_crtc_info( _connection, info->crtc, timestamp ) );
+        }
+        free( info );
+    }
+
+    for( size_t i = 0; i < connected.size(); ++i )
+    {
+        auto crtc = wait_for_reply<xcb_randr_get_crtc_info_reply_t>( _connection, crtc_cookies[i].sequence );
+        if( crtc && crtc->mode != XCB_NONE )
+        {
+            auto& output  = _outputs.emplace_back( std::move( connected[i] ) );
+            output.x      = crtc->x;
+            output.y      = crtc->y;
+            output.width  = crtc->width;
+            output.height = crtc->height;
+            auto mode     = std::find_if( modes.begin(), modes.end(), [&]( auto& mode ) { return mode.id == crtc->mode; } );
+            if( mode != modes.end() ) output.refresh_mhz = refresh_mhz( *mode );
+        }
+        free( crtc );
+    }
+    free( resources );
+
+    std::stable_partition( _outputs.begin(), _outputs.end(), []( auto& output ) { return output.primary; } );
+}
+
+} // namespace aer::xcb
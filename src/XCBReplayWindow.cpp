@@ -0,0 +1,51 @@
+#include <Graphics/XCBReplayWindow.h>
+
+#include <thread>
+
+namespace aer
+{
+using namespace aer::xcb;
+
+namespace
+{
+    const trace_header_t& checked_header( const ref_ptr<trace_reader>& trace )
+    {
+        if( !trace->valid() ) ABORT_F( "Failed to load input trace" );
+        return trace->header();
+    }
+}
+
+XCBReplayWindow::XCBReplayWindow( const std::string& path, pacing mode, const WindowProperties& props )
+:   XCBReplayWindow( ref_ptr<trace_reader>( new trace_reader( path ) ), mode, props )
+{}
+
+XCBReplayWindow::XCBReplayWindow( ref_ptr<trace_reader> trace, pacing mode, const WindowProperties& props )
+:   XCBWindow( props, checked_header( trace ) ),
+    _trace_reader( std::move( trace ) ),
+    _pacing( mode )
+{}
+
+void XCBReplayWindow::Rewind()
+{
+    _trace_reader->rewind();
+    _offset.reset();
+}
+
+bool XCBReplayWindow::PollEvents( Events& events, bool clear_unhandled )
+{
+    if( const auto recorded = _trace_reader->peek() )
+    {
+        // shift the whole recording by one constant, so relative timing and the server clock
+        // estimate replay exactly; fast replays just never wait for a batch to come due
+        if( !_offset ) _offset = clock::now() - *recorded;
+        const auto dispatched = *recorded + *_offset;
+        if( _pacing == pacing::REAL_TIME ) std::this_thread::sleep_until( dispatched );
+
+        _trace_reader->next( *_queue );
+        for( auto& queued : *_queue ) queued.received += *_offset;
+        ProcessQueue( dispatched, false );
+    }
+    return aer::Window::PollEvents( events, clear_unhandled );
+}
+
+} // namespace aer
@@ -0,0 +1,314 @@
+#include <Graphics/XCBSelection.h>
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace aer
+{
+using namespace aer::xcb;
+
+namespace
+{
+    // beyond what the server allows per request, smaller chunks keep each poll short
+    constexpr size_t max_chunk_bytes = 256 * 1024;
+    // a transfer that has not moved for this long is abandoned, as the peer probably went away
+    constexpr auto stall_timeout = std::chrono::seconds( 10 );
+}
+
+selection_source_t selection_source_t::from_span( xcb_atom_t target, std::span<const std::byte> data, xcb_atom_t type )
+{
+    auto read = [data]( size_t offset, size_t max )
+    {
+        const auto rest = data.subspan( std::min( offset, data.size() ) );
+        return rest.first( std::min( max, rest.size() ) );
+    };
+    return { target, type != XCB_NONE ? type : target, data.size(), read };
+}
+
+XCBSelection::XCBSelection( ref_ptr<XCBConnection> display, xcb_window_t window )
+:   _display( std::move( display ) ),
+    _connection( _display->Native() ),
+    _window( window ),
+    _property( _display->Atoms()[ATOM_AER_SELECTION] )
+{
+    xcb_prefetch_maximum_request_length( _connection );
+}
+
+XCBSelection::~XCBSelection()
+{
+    for( auto& transfer : _transfers ) _display->WatchProperties( transfer.requestor, _window, false );
+    if( _fetch && _fetch->reply ) xcb_discard_reply( _connection, _fetch->reply->sequence );
+}
+
+size_t XCBSelection::ChunkBytes()
+{
+    if( _chunk_bytes == 0 )
+    {
+        const size_t max_request = size_t{ xcb_get_maximum_request_length( _connection ) } * 4;
+        _chunk_bytes = std::min( max_request - sizeof( xcb_change_property_request_t ), max_chunk_bytes ) & ~size_t{ 3 };
+    }
+    return _chunk_bytes;
+}
+
+void XCBSelection::Own( xcb_atom_t selection, std::vector<selection_source_t> sources, xcb_timestamp_t time )
+{
+    for( auto& source : sources ) if( source.type == XCB_NONE ) source.type = source.target;
+    _owned[selection] = { std::move( sources ), time };
+    xcb_set_selection_owner( _connection, _window, selection, time );
+    xcb_flush( _connection );
+}
+
+void XCBSelection::Disown( xcb_atom_t selection, xcb_timestamp_t time )
+{
+    if( !_owned.erase( selection ) ) return;
+    xcb_set_selection_owner( _connection, XCB_NONE, selection, time );
+    xcb_flush( _connection );
+}
+
+void XCBSelection::Fetch( xcb_atom_t selection, xcb_atom_t target, selection_sink sink, xcb_timestamp_t time )
+{
+    fetch_t fetch;
+    fetch.selection = selection;
+    fetch.target    = target;
+    fetch.sink      = std::move( sink );
+    fetch.time      = time;
+    _pending.push_back( std::move( fetch ) );
+}
+
+bool XCBSelection::HandleEvent( const xcb_generic_event_t* event )
+{
+    switch( event->response_type & ~SERVER_USER_MASK )
+    {
+        case XCB_SELECTION_REQUEST:
+        {
+            Serve( reinterpret_cast<const xcb_selection_request_event_t*>( event ) );
+            return true;
+        }
+        case XCB_SELECTION_CLEAR:
+        {
+            // transfers already running keep their sources and finish
+            _owned.erase( reinterpret_cast<const xcb_selection_clear_event_t*>( event )->selection );
+            return true;
+        }
+        case XCB_SELECTION_NOTIFY:
+        {
+            auto notify = reinterpret_cast<const xcb_selection_notify_event_t*>( event );
+            if( !_fetch || _fetch->converted || notify->selection != _fetch->selection || notify->target != _fetch->target ) return true;
+            if( notify->property == XCB_NONE ) FinishFetch( SELECTION_FAILED );
+            else
+            {
+                _fetch->converted = true;
+                ReadProperty();
+            }
+            return true;
+        }
+        case XCB_PROPERTY_NOTIFY:
+        {
+            auto notify = reinterpret_cast<const xcb_property_notify_event_t*>( event );
+            if( notify->window == _window && notify->atom == _property && notify->state == XCB_PROPERTY_NEW_VALUE )
+            {
+                // each new value is the next chunk of an incremental fetch. While a read is out,
+                // the value may be the first chunk after an INCR property not yet seen to be one
+                if( !_fetch || !_fetch->converted ) return true;
+                if( _fetch->reply ) _fetch->new_value = true;
+                else if( _fetch->incremental ) ReadProperty();
+                return true;
+            }
+            if( notify->state == XCB_PROPERTY_DELETE ) PropertyDeleted( notify );
+            return true;
+        }
+        default: return false;
+    }
+}
+
+void XCBSelection::Serve( const xcb_selection_request_event_t* request )
+{
+    auto& atoms = _display->Atoms();
+    xcb_selection_notify_event_t notify{};
+    notify.response_type = XCB_SELECTION_NOTIFY;
+    notify.time          = request->time;
+    notify.requestor     = request->requestor;
+    notify.selection     = request->selection;
+    notify.target        = request->target;
+    notify.property      = XCB_NONE;
+
+    // obsolete clients leave the choice of property to the owner; requests from before we
+    // took the selection over are not ours to answer. Ownership taken before any event told us
+    // the server time has nothing to compare against, and the server already vouched for it
+    const auto property = request->property != XCB_NONE ? request->property : request->target;
+    auto owned = _owned.find( request->selection );
+    const bool current = owned != _owned.end()
+                      && ( request->time == XCB_CURRENT_TIME || owned->second.time == XCB_CURRENT_TIME
+                        || static_cast<int32_t>( request->time - owned->second.time ) >= 0 );
+
+    if( current && request->target == atoms[ATOM_TARGETS] )
+    {
+        std::vector<xcb_atom_t> targets{ atoms[ATOM_TARGETS] };
+        for( auto& source : owned->second.sources ) targets.push_back( source.target );
+        xcb_change_property( _connection, XCB_PROP_MODE_REPLACE, request->requestor, property, XCB_ATOM_ATOM, ATOM_SIZE_32, targets.size(), targets.data() );
+        notify.property = property;
+    }
+    else if( current )
+    {
+        auto& sources = owned->second.sources;
+        auto source = std::find_if( sources.begin(), sources.end(), [&]( auto& source ) { return source.target == request->target; } );
+        if( source != sources.end() && source->size <= ChunkBytes() )
+        {
+            WriteProperty( request->requestor, property, *source );
+            notify.property = property;
+        }
+        else if( source != sources.end() )
+        {
+            // a requestor reusing a property has given up on what was in it before
+            std::erase_if( _transfers, [&]( auto& transfer )
+            {
+                const bool stale = transfer.requestor == request->requestor && transfer.property == property;
+                if( stale ) _display->WatchProperties( transfer.requestor, _window, false );
+                return stale;
+            });
+
+            // INCR announces a lower bound of the size; every deletion of the property then
+            // asks for the next chunk, until an empty one ends the transfer
+            const auto size = static_cast<uint32_t>( std::min<size_t>( source->size, std::numeric_limits<uint32_t>::max() ) );
+            _display->WatchProperties( request->requestor, _window, true );
+            xcb_change_property( _connection, XCB_PROP_MODE_REPLACE, request->requestor, property, atoms[ATOM_INCR], ATOM_SIZE_32, 1, &size );
+            _transfers.push_back( { request->requestor, property, *source, 0, clock::now() } );
+            notify.property = property;
+        }
+    }
+
+    xcb_send_event( _connection, false, request->requestor, XCB_EVENT_MASK_NO_EVENT, reinterpret_cast<const char*>( &notify ) );
+    xcb_flush( _connection );
+}
+
+void XCBSelection::WriteProperty( xcb_window_t requestor, xcb_atom_t property, const selection_source_t& source )
+{
+    // a source may hand out less than asked for, so even a small payload can take several reads
+    size_t offset = 0;
+    while( offset < source.size )
+    {
+        const auto chunk = source.read( offset, source.size - offset );
+        if( chunk.empty() ) break;
+        xcb_change_property( _connection, offset == 0 ? XCB_PROP_MODE_REPLACE : XCB_PROP_MODE_APPEND, requestor, property,
+                             source.type, ATOM_SIZE_8, chunk.size(), chunk.data() );
+        offset += chunk.size();
+    }
+    if( offset == 0 ) xcb_change_property( _connection, XCB_PROP_MODE_REPLACE, requestor, property, source.type, ATOM_SIZE_8, 0, nullptr );
+}
+
+void XCBSelection::PropertyDeleted( const xcb_property_notify_event_t* notify )
+{
+    auto transfer = std::find_if( _transfers.begin(), _transfers.end(), [&]( auto& transfer )
+    {
+        return transfer.requestor == notify->window && transfer.property == notify->atom;
+    });
+    if( transfer == _transfers.end() ) return;
+
+    const auto chunk = transfer->source.read( transfer->offset, ChunkBytes() );
+    xcb_change_property( _connection, XCB_PROP_MODE_REPLACE, transfer->requestor, transfer->property,
+                         transfer->source.type, ATOM_SIZE_8, chunk.size(), chunk.data() );
+    transfer->offset += chunk.size();
+    transfer->active  = clock::now();
+
+    // the requestor deletes the closing empty chunk without needing anything more from us
+    if( chunk.empty() )
+    {
+        _display->WatchProperties( transfer->requestor, _window, false );
+        _transfers.erase( transfer );
+    }
+    xcb_flush( _connection );
+}
+
+void XCBSelection::StartFetch()
+{
+    if( _fetch || _pending.empty() ) return;
+    _fetch = std::move( _pending.front() );
+    _pending.pop_front();
+    _fetch->active = clock::now();
+
+    // a value left behind by an abandoned transfer would be taken for the answer
+    xcb_delete_property( _connection, _window, _property );
+    xcb_convert_selection( _connection, _window, _fetch->selection, _fetch->target, _property, _fetch->time );
+    xcb_flush( _connection );
+}
+
+void XCBSelection::ReadProperty()
+{
+    // deleting on read only happens once nothing is left after what was returned, so the
+    // owner of an incremental transfer hears about it after the last part of each chunk
+    _fetch->reply  = xcb_get_property( _connection, true, _window, _property, XCB_GET_PROPERTY_TYPE_ANY, _fetch->offset, ChunkBytes() / 4 );
+    _fetch->active = clock::now();
+    xcb_flush( _connection );
+}
+
+void XCBSelection::PropertyRead( xcb_get_property_reply_t* reply )
+{
+    auto& fetch = *_fetch;
+    if( !fetch.incremental && fetch.offset == 0 && reply->type == _display->Atoms()[ATOM_INCR] )
+    {
+        // reading it deleted the INCR property, which has the owner send the first chunk;
+        // a quick owner may already have
+        fetch.incremental = true;
+        if( std::exchange( fetch.new_value, false ) ) ReadProperty();
+        return;
+    }
+
+    const auto bytes = static_cast<size_t>( xcb_get_property_value_length( reply ) );
+    fetch.received += bytes;
+    if( bytes > 0 ) fetch.sink( { static_cast<const std::byte*>( xcb_get_property_value( reply ) ), bytes }, reply->type, SELECTION_DATA );
+
+    if( reply->bytes_after > 0 )
+    {
+        fetch.offset += static_cast<uint32_t>( bytes / 4 );
+        ReadProperty();
+    }
+    else if( !fetch.incremental || fetch.received == 0 ) FinishFetch( SELECTION_DONE );
+    else
+    {
+        fetch.offset   = 0;
+        fetch.received = 0;
+        if( std::exchange( fetch.new_value, false ) ) ReadProperty();
+    }
+}
+
+void XCBSelection::FinishFetch( selection_status status )
+{
+    auto fetch = std::move( *_fetch );
+    _fetch.reset();
+    if( fetch.reply ) xcb_discard_reply( _connection, fetch.reply->sequence );
+    fetch.sink( {}, XCB_NONE, status );
+    StartFetch();
+}
+
+void XCBSelection::Update( clock::time_point now )
+{
+    std::erase_if( _transfers, [&]( auto& transfer )
+    {
+        const bool stalled = now - transfer.active > stall_timeout;
+        if( stalled )
+        {
+            LOG_F( INFO, "Abandoning selection transfer to window %u after %zu bytes", transfer.requestor, transfer.offset );
+            _display->WatchProperties( transfer.requestor, _window, false );
+        }
+        return stalled;
+    });
+
+    StartFetch();
+    if( _fetch && _fetch->reply )
+    {
+        void* reply = nullptr;
+        xcb_generic_error_t* error = nullptr;
+        if( xcb_poll_for_reply( _connection, _fetch->reply->sequence, &reply, &error ) )
+        {
+            _fetch->reply.reset();
+            free( error );
+            if( auto property = static_cast<xcb_get_property_reply_t*>( reply ) ) PropertyRead( property );
+            else FinishFetch( SELECTION_FAILED );
+            free( reply );
+        }
+    }
+    if( _fetch && now - _fetch->active > stall_timeout ) FinishFetch( SELECTION_FAILED );
+}
+
+} // namespace aer
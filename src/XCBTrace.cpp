@@ -0,0 +1,215 @@
+#include <Graphics/XCBTrace.h>
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace aer::xcb
+{
+
+static_assert( sizeof( trace_header_t ) % 8 == 0 );
+static_assert( sizeof( trace_batch_t ) == 16 && sizeof( trace_event_t ) == 16 );
+
+namespace
+{
+    constexpr size_t padded( size_t size ) { return ( size + 7 ) & ~size_t{ 7 }; }
+
+    int64_t to_nanoseconds( std::chrono::steady_clock::time_point time )
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>( time.time_since_epoch() ).count();
+    }
+
+    std::chrono::steady_clock::time_point from_nanoseconds( int64_t nanoseconds )
+    {
+        return std::chrono::steady_clock::time_point( std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::nanoseconds( nanoseconds ) ) );
+    }
+
+    // the header goes to disk byte for byte, so it is rebuilt field by field over zeroed memory;
+    // a plain copy could carry stack contents in its padding and in the storage of the valuators'
+    // last positions, which replay discards anyway. Traces of the same session then match
+    struct clean_header_t
+    {
+        alignas( trace_header_t ) std::array<std::byte, sizeof( trace_header_t )> bytes{};
+
+        clean_header_t( const trace_header_t& header )
+        {
+            auto clean = new( bytes.data() ) trace_header_t;
+            clean->window               = header.window;
+            clean->root                 = header.root;
+            clean->parent               = header.parent;
+            clean->delete_protocol      = header.delete_protocol;
+            clean->x                    = header.x;
+            clean->y                    = header.y;
+            clean->width                = header.width;
+            clean->height               = header.height;
+            clean->xinput_opcode        = header.xinput_opcode;
+            clean->pointer_input        = header.pointer_input;
+            clean->num_scroll_valuators = header.num_scroll_valuators;
+            clean->keymap               = header.keymap;
+            for( size_t i = 0; i < header.scroll_valuators.size(); ++i )
+            {
+                auto& valuator      = clean->scroll_valuators[i];
+                valuator.device     = header.scroll_valuators[i].device;
+                valuator.number     = header.scroll_valuators[i].number;
+                valuator.horizontal = header.scroll_valuators[i].horizontal;
+                valuator.increment  = header.scroll_valuators[i].increment;
+            }
+        }
+    };
+}
+
+size_t event_size( const xcb_generic_event_t* event )
+{
+    if( ( event->response_type & ~SERVER_USER_MASK ) != XCB_GE_GENERIC ) return sizeof( xcb_generic_event_t );
+    return sizeof( xcb_generic_event_t ) + 4 * size_t{ reinterpret_cast<const xcb_ge_generic_event_t*>( event )->length };
+}
+
+//-----------------------------------------------------------------------------------------------//
+//                                   WRITER                                                      //
+//-----------------------------------------------------------------------------------------------//
+trace_writer::trace_writer( const std::string& path, const trace_header_t& header )
+:   _fd( open( path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 ) )
+{
+    if( _fd < 0 )
+    {
+        LOG_F( ERROR, "Failed to open trace %s: %s", path.c_str(), strerror( errno ) );
+        return;
+    }
+    _buffer.reserve( flush_threshold * 2 );
+    const clean_header_t clean( header );
+    append( clean.bytes.data(), clean.bytes.size() );
+}
+
+trace_writer::~trace_writer()
+{
+    if( _fd < 0 ) return;
+    flush();
+    close( _fd );
+}
+
+void trace_writer::append( const void* data, size_t size )
+{
+    const auto bytes = static_cast<const std::byte*>( data );
+    _buffer.insert( _buffer.end(), bytes, bytes + size );
+    _buffer.resize( padded( _buffer.size() ) );
+}
+
+void trace_writer::write( std::chrono::steady_clock::time_point dispatched, std::span<const queued_event_t> batch )
+{
+    if( _fd < 0 || batch.empty() ) return;
+
+    const trace_batch_t record{ to_nanoseconds( dispatched ), static_cast<uint32_t>( batch.size() ), 0 };
+    append( &record, sizeof( record ) );
+    for( auto& queued : batch )
+    {
+        const trace_event_t event{ to_nanoseconds( queued.received ), static_cast<uint32_t>( event_size( queued.event ) ), 0 };
+        append( &event, sizeof( event ) );
+        append( queued.event, event.size );
+    }
+    if( _buffer.size() >= flush_threshold ) flush();
+}
+
+void trace_writer::flush()
+{
+    size_t written = 0;
+    while( _fd >= 0 && written < _buffer.size() )
+    {
+        const auto result = ::write( _fd, _buffer.data() + written, _buffer.size() - written );
+        if( result < 0 && errno == EINTR ) continue;
+        if( result <= 0 )
+        {
+            LOG_F( ERROR, "Failed to write trace: %s", strerror( errno ) );
+            close( std::exchange( _fd, -1 ) );
+            break;
+        }
+        written += result;
+    }
+    _buffer.clear();
+}
+
+//-----------------------------------------------------------------------------------------------//
+//                                   READER                                                      //
+//-----------------------------------------------------------------------------------------------//
+trace_reader::trace_reader( const std::string& path )
+{
+    const int fd = open( path.c_str(), O_RDONLY | O_CLOEXEC );
+    struct stat status{};
+    if( fd < 0 || fstat( fd, &status ) != 0 )
+    {
+        LOG_F( ERROR, "Failed to open trace %s: %s", path.c_str(), strerror( errno ) );
+        if( fd >= 0 ) close( fd );
+        return;
+    }
+
+    _size = static_cast<size_t>( status.st_size );
+    if( _size >= sizeof( trace_header_t ) )
+    {
+        auto mapping = mmap( nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if( mapping != MAP_FAILED )
+        {
+            _data = static_cast<const std::byte*>( mapping );
+            madvise( mapping, _size, MADV_SEQUENTIAL );
+        }
+    }
+    close( fd );
+
+    auto header = reinterpret_cast<const trace_header_t*>( _data );
+    if( !header || header->magic != trace_header_t::expected_magic
+                || header->version != trace_header_t::current_version
+                || header->symbol_size != sizeof( key::symbol ) )
+    {
+        LOG_F( ERROR, "%s is not a trace this build can read", path.c_str() );
+        return;
+    }
+    _header = header;
+    rewind();
+}
+
+trace_reader::~trace_reader()
+{
+    if( _data ) munmap( const_cast<std::byte*>( _data ), _size );
+}
+
+std::optional<trace_reader::clock::time_point> trace_reader::peek() const
+{
+    if( !_header || _cursor + sizeof( trace_batch_t ) > _size ) return std::nullopt;
+    return from_nanoseconds( reinterpret_cast<const trace_batch_t*>( _data + _cursor )->dispatched );
+}
+
+std::optional<trace_reader::clock::time_point> trace_reader::next( std::vector<queued_event_t>& batch )
+{
+    batch.clear();
+    if( !_header || _cursor + sizeof( trace_batch_t ) > _size ) return std::nullopt;
+
+    const auto record = reinterpret_cast<const trace_batch_t*>( _data + _cursor );
+    auto cursor = _cursor + sizeof( trace_batch_t );
+    for( uint32_t i = 0; i < record->count; ++i )
+    {
+        const auto event = reinterpret_cast<const trace_event_t*>( _data + cursor );
+        if( cursor + sizeof( trace_event_t ) > _size || event->size < sizeof( xcb_generic_event_t )
+         || cursor + sizeof( trace_event_t ) + event->size > _size )
+        {
+            // a recording cut short mid-write; stop at the last complete batch
+            LOG_F( WARNING, "Trace truncated at byte %zu", cursor );
+            batch.clear();
+            _cursor = _size;
+            return std::nullopt;
+        }
+
+        // translation only reads events, so they are handed out straight from the mapping
+        auto data = const_cast<std::byte*>( _data + cursor + sizeof( trace_event_t ) );
+        batch.push_back( { reinterpret_cast<xcb_generic_event_t*>( data ), from_nanoseconds( event->received ) } );
+        cursor += sizeof( trace_event_t ) + padded( event->size );
+    }
+    _cursor = cursor;
+    return from_nanoseconds( record->dispatched );
+}
+
+} // namespace aer::xcb
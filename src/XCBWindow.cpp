@@ -1,50 +1,27 @@
 #include <Graphics/XCBWindow.h>
 
+#include <Input/EventPool.h>
+#include <Input/EventTime.h>
 #include <Input/MouseCodes.h>
 #include <Input/KeyCodes.h>
+#include <Input/PointerEvents.h>
 
 #include <Events/WindowEvents.h>
 #include <Events/KeyEvents.h>
 #include <Events/MouseEvents.h>
 
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
 #include <cstring>
-#include <thread>
+#include <optional>
+#include <typeinfo>
+#include <utility>
 
-namespace aer::xcb
-{
-
-enum atom_size : uint8_t
-{
-    ATOM_SIZE_8     = 8,
-    ATOM_SIZE_16    = 16,
-    ATOM_SIZE_32    = 32
-};
+#include <poll.h>
 
-struct atom_request_t
+namespace aer::xcb
 {
-    xcb_connection_t*        _connection = nullptr;
-    xcb_intern_atom_cookie_t _cookie{};
-    xcb_atom_t               _atom{};
-    
-    atom_request_t( xcb_connection_t* in_connection, const char* atom_name )
-    :   _connection( in_connection ), 
-        _cookie( xcb_intern_atom( _connection, false, strlen( atom_name ), atom_name ) )
-    {}
-
-    operator xcb_atom_t()
-    {
-        if( _connection )
-        {
-            if( auto reply = xcb_intern_atom_reply( _connection, _cookie, nullptr ) )
-            {
-                _atom = reply->atom;
-                free( reply );
-            } 
-            _connection = nullptr;
-        }
-        return _atom;
-    }
-};
 
 struct motif_hints_t
 {
@@ -101,124 +78,6 @@ struct motif_hints_t
     }
 };
 
-bool getWindowGeometry( xcb_connection_t* connection, xcb_window_t window, int& x, int& y, uint32_t& width, uint32_t& height )
-{
-    const auto geometry_cookie = xcb_get_geometry( connection, window );
-    if( auto geometry_reply = xcb_get_geometry_reply( connection, geometry_cookie, nullptr ) )
-    {
-        x = geometry_reply->x;
-        y = geometry_reply->y;
-        width = geometry_reply->width;
-        height = geometry_reply->height;
-
-        const auto tree_cookie = xcb_query_tree( connection, window );
-        if( auto tree_reply = xcb_query_tree_reply( connection, tree_cookie, nullptr ) )
-        {
-            const auto trans_cookie = xcb_translate_coordinates( connection, window, tree_reply->parent, x, y );
-            if( auto trans_reply = xcb_translate_coordinates_reply( connection, trans_cookie, nullptr ) )
-            {
-                x = trans_reply->dst_x;
-                y = trans_reply->dst_y;
-                free( trans_reply );
-            }
-            free( tree_reply );
-        }
-        free( geometry_reply );
-        return true;
-    }
-    return false;
-}
-
-struct keyboard_map : Object
-{
-    using code_mod_pair = std::pair<uint16_t, uint16_t>;
-    using code_map      = std::map<code_mod_pair, key::symbol>;
-    
-
-    keyboard_map( xcb_connection_t* connection )
-    {
-        auto setup = xcb_get_setup( connection );
-        auto min_keycode = setup->min_keycode;
-        auto max_keycode = setup->max_keycode;
-        auto cookie = xcb_get_keyboard_mapping( connection, min_keycode, max_keycode - min_keycode + 1 );
-
-        if( auto reply = xcb_get_keyboard_mapping_reply( connection, cookie, nullptr ) )
-        {
-            auto keysyms = xcb_get_keyboard_mapping_keysyms( reply );
-            auto length = xcb_get_keyboard_mapping_keysyms_length( reply );
-            auto keysyms_per_keycode = reply->keysyms_per_keycode;
-
-            for( int i = 0; i < length; i += keysyms_per_keycode )
-            {
-                auto keysym = &keysyms[i];
-                auto keycode = min_keycode + i / keysyms_per_keycode;
-                for( int j = 0; j < keysyms_per_keycode; ++j )
-                {
-                    if( keysym[j] != 0 ) _keymap[{ keycode, j }] = keysym[j];
-                }
-            }
-            free( reply );
-        } 
-    }
-
-    key_symbol symbol( uint16_t keycode, uint16_t modifier = 0 )
-    {
-        auto itr = _keymap.find( { keycode, modifier } );
-        if( itr == _keymap.end() ) return KEY_Undefined;
-        
-        auto base_key = itr->second;
-        if( modifier == 0 ) return static_cast<key_symbol>( base_key );
-
-        uint16_t index = 0;
-        bool shift = (modifier & key::MOD_Shift) != 0;
-        bool numpad = base_key >= KEY_KP_Space && base_key <= KEY_KP_Divide;
-
-        if( numpad )
-        {
-            bool numlock = (modifier & key::MOD_NumLock) != 0;
-            index = numlock && !shift ? 1 : 0;
-        }
-        else
-        {
-            bool capslock = (modifier & key::MOD_CapsLock) != 0;
-            index = capslock && shift ? 1 : 0;
-        }
-        if( index == 0 ) return static_cast<key_symbol>( base_key );
-        if( itr = _keymap.find( { keycode, index } ); itr != _keymap.end() ) return static_cast<key_symbol>( itr->second );
-        else return KEY_Undefined;
-    }
-
-    key::mod mod( key::symbol symbol, uint16_t modifier, bool pressed )
-    {
-        uint16_t mask{ 0 };
-        if( symbol >= KEY_Shift_L && symbol <= KEY_Hyper_R )
-        {
-            switch( symbol )
-            {
-                case KEY_Shift_L:
-                case KEY_Shift_R:   mask = XCB_KEY_BUT_MASK_SHIFT; break;
-                case KEY_Control_L:
-                case KEY_Control_R: mask = XCB_KEY_BUT_MASK_CONTROL; break;
-                case KEY_Alt_L:
-                case KEY_Alt_R:     mask = XCB_KEY_BUT_MASK_MOD_1; break;
-                case KEY_Meta_L:
-                case KEY_Meta_R:    mask = XCB_KEY_BUT_MASK_MOD_2; break;
-                case KEY_Hyper_L:
-                case KEY_Hyper_R:   mask = XCB_KEY_BUT_MASK_MOD_3; break;
-                case KEY_Super_L:
-                case KEY_Super_R:   mask = XCB_KEY_BUT_MASK_MOD_4; break;
-                default: break;
-            }
-        }
-        pressed ? modifier |= mask : modifier &= ~mask;
-        return key::mod{ modifier };
-    }
-
-protected:
-    code_map _keymap;
-    uint16_t _modmask{ 0XFF };
-};
-
 } // namespace aer::xcb
 
 namespace aer
@@ -230,236 +89,776 @@ ref_ptr<Window> createWindow( const WindowProperties& props )
     return ref_ptr<Window>( new XCBWindow( { props } ) );
 }
 
-enum : uint8_t { SERVER_USER_MASK = 0x80 };
-
 XCBWindow::XCBWindow( const WindowProperties& props )
 :   Window( props ),
-    _first_xcb_timestamp( 0 ),
-    _first_xcb_time_point( clock::now() ),
-    _connection( [&] -> xcb_connection_t*
+    _display( [&] -> ref_ptr<XCBConnection>
     {
-        const auto display = !_properties.display.empty()
-                           ? _properties.display.c_str()
-                           : nullptr;
-
-        auto connection = props.systemConnection.has_value()
-                        ? std::any_cast<xcb_connection_t*>( props.systemConnection )
-                        : xcb_connect( display, &_properties.screenNum );
-
-        if( xcb_connection_has_error( connection ) == 0 ) return connection;
-        else xcb_disconnect( connection );
-        ABORT_F( "Failed to establish xcb connection" );
-    }()),
-    _screen( [&] -> xcb_screen_t*
-    {
-        const auto setup = xcb_get_setup( _connection );
-        const auto screenCount = xcb_setup_roots_length( setup );
-        
-        LOG_IF_F( WARNING, props.screenNum >= screenCount, "Requested screen %d, only %d screens available", props.screenNum, screenCount );
-        const auto screenNum = props.screenNum < screenCount ? props.screenNum : 0;
-        auto screen_iterator = xcb_setup_roots_iterator( setup );
-        for( int i = 0; i < screenNum; ++i ) xcb_screen_next( &screen_iterator );
-        return screen_iterator.data;
+        if( !props.systemConnection.has_value() ) return XCBConnection::Open( _properties.display, &_properties.screenNum );
+        if( props.systemConnection.type() == typeid( ref_ptr<XCBConnection> ) )
+        {
+            return std::any_cast<ref_ptr<XCBConnection>>( props.systemConnection );
+        }
+        return XCBConnection::Adopt( std::any_cast<xcb_connection_t*>( props.systemConnection ) );
     }()),
+    _connection( _display->Native() ),
+    _screen( _display->Screen( props.screenNum ) ),
     _window( props.nativeWindow.has_value() ? std::any_cast<xcb_window_t>( props.nativeWindow ) : xcb_generate_id( _connection ) ),
-    _window_delete_protocol( atom_request_t( _connection, "WM_DELETE_WINDOW" ) )
+    _root( _screen->root ),
+    _parent( _root ),
+    _queue( &_display->Register( _window ) )
 {
-    const auto atom_request = [&]( const char* atom_name ) { return atom_request_t( _connection, atom_name ); };
     const auto change_property = [&]( xcb_atom_t atom, xcb_atom_enum_t type, uint8_t format, uint32_t data_len, const void* data )
     {
         return xcb_change_property( _connection, XCB_PROP_MODE_REPLACE, _window, atom, type, format, data_len, data );
     };
 
+    _selected_mask              = _event_mask | RequiredEventMask();
     const uint32_t value_mask   = XCB_CW_BACK_PIXEL | XCB_CW_EVENT_MASK | XCB_CW_BIT_GRAVITY | XCB_CW_OVERRIDE_REDIRECT;
-    const uint32_t event_mask   = XCB_EVENT_MASK_EXPOSURE | XCB_EVENT_MASK_STRUCTURE_NOTIFY
-                                | XCB_EVENT_MASK_FOCUS_CHANGE | XCB_EVENT_MASK_PROPERTY_CHANGE
-                                | XCB_EVENT_MASK_KEY_PRESS | XCB_EVENT_MASK_KEY_RELEASE
-                                | XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_BUTTON_RELEASE | XCB_EVENT_MASK_POINTER_MOTION;
-    const uint32_t value_list[] = { _screen->black_pixel, XCB_GRAVITY_NORTH_WEST, 0, event_mask };
+    const uint32_t value_list[] = { _screen->black_pixel, XCB_GRAVITY_NORTH_WEST, 0, _selected_mask };
     const auto hints            = props.borderless ? motif_hints_t::borderless() : motif_hints_t::window();
-    const auto state            = atom_request( "_NET_WM_STATE_FULLSCREEN" );
+
+    if( props.fullscreen )
+    {
+        _properties.posx   = 0;
+        _properties.posy   = 0;
+        _properties.width  = _screen->width_in_pixels;
+        _properties.height = _screen->height_in_pixels;
+    }
 
     xcb_create_window
     ( 
         _connection, XCB_COPY_FROM_PARENT, _window, _screen->root,
-        props.fullscreen ? 0 : props.posx,
-        props.fullscreen ? 0 : props.posy,
-        props.fullscreen ? _screen->width_in_pixels : props.width,
-        props.fullscreen ? _screen->height_in_pixels : props.height,
+        _properties.posx, _properties.posy, _properties.width, _properties.height,
         0, XCB_WINDOW_CLASS_INPUT_OUTPUT, _screen->root_visual, value_mask, value_list
     );
 
     change_property( XCB_ATOM_WM_CLASS, XCB_ATOM_STRING, ATOM_SIZE_8, props.windowClass.size(), props.windowClass.c_str() );
     change_property( XCB_ATOM_WM_NAME, XCB_ATOM_STRING, ATOM_SIZE_8, props.name.size(), props.name.c_str() );
-    change_property( atom_request( "WM_PROTOCOLS" ), XCB_ATOM_ATOM, ATOM_SIZE_32, 1, &_window_delete_protocol );
-    change_property( atom_request( "_MOTIF_WM_HINTS" ), XCB_ATOM_WM_HINTS, ATOM_SIZE_32, motif_hints_t::num_fields, &hints );
-    if( props.fullscreen ) change_property( atom_request( "_NET_WM_STATE" ), XCB_ATOM_ATOM, ATOM_SIZE_32, 1, &state );
 
-    while( auto event = xcb_wait_for_event( _connection ) )
+    // the only round-trip of creating the first window on a connection, none after that;
+    // the keyboard mapping reply rides along
+    auto& atoms = _display->Atoms();
+    const auto state        = atoms[ATOM_NET_WM_STATE_FULLSCREEN];
+    _window_delete_protocol = atoms[ATOM_WM_DELETE_WINDOW];
+    _display->Keymap().update();
+
+    change_property( atoms[ATOM_WM_PROTOCOLS], XCB_ATOM_ATOM, ATOM_SIZE_32, 1, &_window_delete_protocol );
+    change_property( atoms[ATOM_MOTIF_WM_HINTS], XCB_ATOM_WM_HINTS, ATOM_SIZE_32, motif_hints_t::num_fields, &hints );
+    if( props.fullscreen ) change_property( atoms[ATOM_NET_WM_STATE], XCB_ATOM_ATOM, ATOM_SIZE_32, 1, &state );
+
+    xcb_map_window( _connection, _window );
+    if( xcb_flush( _connection ) <= 0 ) LOG_F( WARNING, "Failed to flush xcb connection" );
+}
+
+XCBWindow::XCBWindow( const WindowProperties& props, const trace_header_t& trace )
+:   Window( props ),
+    _display( XCBConnection::Offline( trace.keymap, ref_ptr<xinput>( new xinput( trace.xinput_opcode,
+              std::span( trace.scroll_valuators ).first( std::min<size_t>( trace.num_scroll_valuators, xinput::max_scroll_valuators ) ) ) ) ) ),
+    _window( trace.window ),
+    _root( trace.root ),
+    _parent( trace.parent ),
+    _window_delete_protocol( trace.delete_protocol ),
+    _queue( &_display->Register( _window ) ),
+    _pointer_input( trace.pointer_input )
+{
+    _properties.posx   = trace.x;
+    _properties.posy   = trace.y;
+    _properties.width  = trace.width;
+    _properties.height = trace.height;
+}
+
+uint64_t XCBWindow::RoundTrips()
+{
+    return round_trip_count.load( std::memory_order_relaxed );
+}
+
+XCBWindow::~XCBWindow()
+{
+    _framebuffer = {};
+    _selection   = {};
+    _display->Unregister( _window );
+    if( !_connection ) return;
+    if( _window != 0 ) xcb_destroy_window( _connection, _window );
+    xcb_flush( _connection );
+}
+
+void XCBWindow::SetThreadedInput( bool enable )
+{
+    _display->SetThreadedInput( enable );
+}
+
+XCBFramebuffer& XCBWindow::Framebuffer()
+{
+    if( !_connection ) ABORT_F( "Offline windows have no framebuffer" );
+    if( !_framebuffer )
     {
-        if( _first_xcb_timestamp != 0 ) { free( event ); break; }
+        _framebuffer = ref_ptr<XCBFramebuffer>( new XCBFramebuffer( _display, _window, _screen->root_depth, _properties.width, _properties.height ) );
+    }
+    else _framebuffer->Resize( _properties.width, _properties.height );
+    return *_framebuffer.get();
+}
 
-        if( ( event->response_type & ~SERVER_USER_MASK ) == XCB_PROPERTY_NOTIFY )
+void XCBWindow::SetEventMask( uint32_t mask )
+{
+    _event_mask = mask;
+    UpdateEventMask();
+}
+
+uint32_t XCBWindow::RequiredEventMask() const
+{
+    // an incremental transfer announces every chunk by a property change on our window
+    const bool fetching = _selection && _selection->Fetching();
+    return XCB_EVENT_MASK_STRUCTURE_NOTIFY | ( fetching ? XCB_EVENT_MASK_PROPERTY_CHANGE : 0 );
+}
+
+void XCBWindow::UpdateEventMask()
+{
+    const uint32_t selected = _event_mask | RequiredEventMask();
+    if( selected == _selected_mask ) return;
+
+    // events the server generated before this arrives are still delivered; they translate as usual
+    _selected_mask = selected;
+    if( !_connection ) return;
+    xcb_change_window_attributes( _connection, _window, XCB_CW_EVENT_MASK, &selected );
+    xcb_flush( _connection );
+}
+
+bool XCBWindow::SetFullscreen( bool enable, std::string_view output )
+{
+    if( !_connection ) return false;
+    auto& atoms = _display->Atoms();
+    if( !enable )
+    {
+        if( !_properties.fullscreen ) return true;
+        SendFullscreenState( false );
+        xcb_delete_property( _connection, _window, atoms[ATOM_NET_WM_BYPASS_COMPOSITOR] );
+        // a window created fullscreen has no windowed geometry of its own; the window manager
+        // picks one for it
+        if( _windowed )
         {
-            auto property_notify    = reinterpret_cast<xcb_property_notify_event_t*>( event );
-            _first_xcb_timestamp    = property_notify->time;
-            _first_xcb_time_point   = clock::now();
+            const auto [x, y, width, height] = *std::exchange( _windowed, std::nullopt );
+            const uint32_t geometry[] = { static_cast<uint32_t>( x ), static_cast<uint32_t>( y ), width, height };
+            xcb_configure_window( _connection, _window, XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y | XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT, geometry );
         }
-        free( event );
+        _fullscreen_output.reset();
+        _properties.fullscreen = false;
+        xcb_flush( _connection );
+        return true;
     }
 
-    xcb_map_window( _connection, _window );
-    if( xcb_flush( _connection ) <= 0 ) LOG_F( WARNING, "Failed to flush xcb connection" );
-    if( auto geometry_reply = xcb_get_geometry_reply( _connection, xcb_get_geometry( _connection, _window ), nullptr ) )
+    auto& randr = _display->RandR();
+    auto target = randr.find( output );
+    if( !target ) return false;
+
+    if( !_properties.fullscreen ) _windowed = CurrentGeometry();
+    _fullscreen_name = output;
+    _output_changes  = randr.changes();
+
+    // 1 asks for unredirection, which saves the compositor's copy and the frame of latency it adds
+    const uint32_t bypass = 1;
+    xcb_change_property( _connection, XCB_PROP_MODE_REPLACE, _window, atoms[ATOM_NET_WM_BYPASS_COMPOSITOR], XCB_ATOM_CARDINAL, ATOM_SIZE_32, 1, &bypass );
+    CoverOutput( *target );
+    return true;
+}
+
+void XCBWindow::CoverOutput( const display_output_t& output )
+{
+    // window managers make a window fullscreen on the monitor it is on and ignore moves while it
+    // is, so it leaves the state, moves over the output and enters it again; without a window
+    // manager the geometry alone covers the output
+    if( _properties.fullscreen ) SendFullscreenState( false );
+    const uint32_t geometry[] = { static_cast<uint32_t>( output.x ), static_cast<uint32_t>( output.y ), output.width, output.height };
+    xcb_configure_window( _connection, _window, XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y | XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT, geometry );
+    SendFullscreenState( true );
+    xcb_flush( _connection );
+
+    _properties.fullscreen = true;
+    _fullscreen_output     = output;
+    _output_pending        = true;
+}
+
+void XCBWindow::SendFullscreenState( bool fullscreen )
+{
+    // _NET_WM_STATE only goes through the window manager once the window is mapped
+    auto& atoms = _display->Atoms();
+    xcb_client_message_event_t message{};
+    message.response_type  = XCB_CLIENT_MESSAGE;
+    message.format         = ATOM_SIZE_32;
+    message.window         = _window;
+    message.type           = atoms[ATOM_NET_WM_STATE];
+    message.data.data32[0] = fullscreen ? 1 : 0;    // _NET_WM_STATE_ADD or _NET_WM_STATE_REMOVE
+    message.data.data32[1] = atoms[ATOM_NET_WM_STATE_FULLSCREEN];
+    message.data.data32[3] = 1;                     // from a normal application
+    xcb_send_event( _connection, false, _root, XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY | XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT,
+                    reinterpret_cast<const char*>( &message ) );
+}
+
+void XCBWindow::UpdateOutput( clock::time_point now )
+{
+    auto& randr = _display->RandR();
+    if( std::exchange( _output_changes, randr.changes() ) != randr.changes() )
     {
-        _properties.posx = geometry_reply->x;
-        _properties.posy = geometry_reply->y;
-        _properties.width = geometry_reply->width;
-        _properties.height = geometry_reply->height;
-        free( geometry_reply );
+        // the primary output stands in for one that went away, until it comes back
+        auto output = randr.find( _fullscreen_name );
+        if( !output ) output = randr.find( {} );
+        if( !output ) LOG_F( WARNING, "No output left to be fullscreen on, staying where the window is" );
+        else if( *output != *_fullscreen_output ) CoverOutput( *output );
     }
+    if( std::exchange( _output_pending, false ) ) EmitAt<WindowOutputEvent>( now, *_fullscreen_output );
 }
 
-XCBWindow::~XCBWindow()
+bool XCBWindow::SetPointerInput( uint8_t flags )
 {
-    if( _connection )
+    const bool available = _display->XInput().available();
+    if( flags != POINTER_CORE && !available ) return false;
+
+    if( _connection && available )
     {
-        if( _window != 0 ) xcb_destroy_window( _connection, _window );
+        // selecting XI_Motion replaces core motion for this window; enter and device changes
+        // invalidate the last scroll valuator positions
+        const uint32_t mask = ( flags & POINTER_PRECISE ) ? XCB_INPUT_XI_EVENT_MASK_MOTION | XCB_INPUT_XI_EVENT_MASK_ENTER
+                                                            | XCB_INPUT_XI_EVENT_MASK_DEVICE_CHANGED
+                                                          : 0;
+        xinput_select( _connection, _window, mask );
+        _display->SetRawInput( _window, flags & POINTER_RAW_MOTION );
         xcb_flush( _connection );
-        xcb_disconnect( _connection );
     }
+    _pointer_input = flags;
+    return true;
 }
-    
-bool XCBWindow::PollEvents( Events& events, bool clear_unhandled )
+
+bool XCBWindow::SetFramePacing( bool enable )
 {
-    static keyboard_map keymap( _connection );
+    if( enable == ( _present_event != 0 ) ) return true;
+    if( enable && !_display->HasPresent() ) return false;
+
+    // deselecting reuses the event id it was selected with
+    if( enable ) _present_event = xcb_generate_id( _connection );
+    xcb_present_select_input( _connection, _present_event, _window,
+                              enable ? XCB_PRESENT_EVENT_MASK_COMPLETE_NOTIFY | XCB_PRESENT_EVENT_MASK_IDLE_NOTIFY : 0 );
+    if( enable ) RequestVblank( 0 );    // a past target completes right away with the current msc
+    else _present_event = 0;
+    _requested_msc.reset();
+    xcb_flush( _connection );
+    return true;
+}
 
-    while( auto event = xcb_poll_for_event( _connection ) )
+xcb::frame_target_t XCBWindow::NextFrame( clock::duration budget )
+{
+    const auto target = _frames.next_frame( clock::now(), budget );
+    if( _present_event != 0 && _frames.calibrated() && _requested_msc != target.msc )
     {
-        switch( auto response_type = event->response_type & ~SERVER_USER_MASK )
+        RequestVblank( target.msc );
+        xcb_flush( _connection );
+    }
+    return target;
+}
+
+void XCBWindow::RequestVblank( uint64_t msc )
+{
+    xcb_present_notify_msc( _connection, _window, ++_present_serial, msc, 0, 0 );
+    _requested_msc = msc;
+}
+
+XCBSelection& XCBWindow::Selection()
+{
+    if( !_connection ) ABORT_F( "Offline windows have no selections" );
+    if( !_selection ) _selection = ref_ptr<XCBSelection>( new XCBSelection( _display, _window ) );
+    return *_selection.get();
+}
+
+void XCBWindow::SetSelection( xcb_atom_t selection, std::vector<selection_source_t> sources )
+{
+    Selection().Own( selection, std::move( sources ), _server_time );
+}
+
+void XCBWindow::ClearSelection( xcb_atom_t selection )
+{
+    if( _selection ) _selection->Disown( selection, _server_time );
+}
+
+void XCBWindow::RequestSelection( xcb_atom_t selection, xcb_atom_t target, selection_sink sink )
+{
+    // property changes have to be selected before the owner can write anything
+    Selection().Fetch( selection, target, std::move( sink ), _server_time );
+    UpdateEventMask();
+    _selection->Update( clock::now() );
+}
+
+bool XCBWindow::StartTrace( const std::string& path )
+{
+    trace_header_t header{};
+    header.window          = _window;
+    header.root            = _root;
+    header.parent          = _parent;
+    header.delete_protocol = _window_delete_protocol;
+    header.x               = _properties.posx;
+    header.y               = _properties.posy;
+    header.width           = _properties.width;
+    header.height          = _properties.height;
+    header.keymap          = _display->Keymap().codes();
+    header.xinput_opcode   = _display->XInputOpcode();
+    header.pointer_input   = _pointer_input;
+    if( header.xinput_opcode != 0 )
+    {
+        const auto& valuators = _display->XInput().scroll_valuators;
+        header.num_scroll_valuators = std::min( valuators.size(), header.scroll_valuators.size() );
+        std::copy_n( valuators.begin(), header.num_scroll_valuators, header.scroll_valuators.begin() );
+    }
+
+    _trace = ref_ptr<trace_writer>( new trace_writer( path, header ) );
+    if( !_trace->valid() ) _trace = {};
+    return _trace.get() != nullptr;
+}
+
+int XCBWindow::FileDescriptor() const
+{
+    return _display->FileDescriptor();
+}
+
+bool XCBWindow::HasPendingEvents()
+{
+    return !_queue->empty() || _display->HasPendingEvents();
+}
+
+bool XCBWindow::WaitEvents( Events& events, std::optional<clock::duration> timeout, bool clear_unhandled )
+{
+    if( !HasPendingEvents() )
+    {
+        pollfd descriptor{ .fd = FileDescriptor(), .events = POLLIN, .revents = 0 };
+        const auto deadline = timeout ? std::optional( clock::now() + *timeout ) : std::nullopt;
+        while( true )
         {
-            //-----------------------------------------------------------------------------------//
-            //                                   WINDOW                                          //
-            //-----------------------------------------------------------------------------------//
-            case XCB_DESTROY_NOTIFY: { _events.emplace_back( new WindowCloseEvent( this ) ); break; }
-            case XCB_EXPOSE: { _events.emplace_back( new WindowExposeEvent( this ) ); break; }
-            case XCB_CLIENT_MESSAGE:
+            // a signal cuts the wait short; go back to sleep for whatever is left of it
+            timespec wait{};
+            if( deadline )
             {
-                auto client_message = reinterpret_cast<xcb_client_message_event_t*>( event );
-                if( client_message->data.data32[0] == _window_delete_protocol )
-                {
-                    _events.emplace_back( new WindowCloseEvent( this ) );
-                }
-                break;
+                const auto remaining = std::max( *deadline - clock::now(), clock::duration::zero() );
+                const auto seconds   = std::chrono::duration_cast<std::chrono::seconds>( remaining );
+                wait = { seconds.count(), std::chrono::duration_cast<std::chrono::nanoseconds>( remaining - seconds ).count() };
             }
-            case XCB_CONFIGURE_NOTIFY:
+            const int ready = ppoll( &descriptor, 1, deadline ? &wait : nullptr, nullptr );
+            if( ready > 0 ) break;
+            if( ready == 0 ) return false;
+            if( errno != EINTR )
             {
-                auto configure = reinterpret_cast<xcb_configure_notify_event_t*>( event );
-                int32_t  x(configure->x), y(configure->y);
-                uint32_t width(configure->width), height(configure->height);
-                xcb::getWindowGeometry( _connection, _window, x, y, width, height );
+                LOG_F( ERROR, "Failed to wait for X events: %s", strerror( errno ) );
+                return false;
+            }
+        }
+    }
+    return PollEvents( events, clear_unhandled );
+}
 
-                bool previousConfigureEventIsEqual = false;
-                for( auto prev : events ) if( auto cwe = dynamic_cast<WindowConfigureEvent*>( prev.get() ) )
-                {
-                    previousConfigureEventIsEqual = ( cwe->width == width && cwe->height == height );
-                }
+bool XCBWindow::PollEvents( Events& events, bool clear_unhandled )
+{
+    _display->Dispatch();
+    ProcessQueue( clock::now() );
+    return aer::Window::PollEvents( events, clear_unhandled );
+}
 
-                if( !previousConfigureEventIsEqual )
-                {
-                    _events.emplace_back( new WindowConfigureEvent( this, x, y, width, height ) );
-                    _properties.width = width;
-                    _properties.height = height;
-                }
+bool XCBWindow::PollEvents( typed_events_t& events )
+{
+    // goes through the virtual poll so a replay window fills the arrays as well
+    const auto appended = events.size();
+    Events untyped;
+    _typed_events = &events;
+    PollEvents( untyped );
+    _typed_events = nullptr;
+    return events.size() != appended;
+}
+
+void XCBWindow::ProcessQueue( clock::time_point dispatched, bool owned )
+{
+    _motion_history.clear();
 
-                break;
+    if( _trace ) _trace->write( dispatched, *_queue );
+    for( auto& queued : *_queue )
+    {
+        _latency.dequeue_to_dispatch.record( dispatched - queued.received );
+        TranslateEvent( queued );
+        if( owned ) free( queued.event );
+    }
+    _queue->clear();
+    FlushMotion();
+
+    // Dispatch has read everything off the socket, so a translate reply requested
+    // during an earlier poll is either queued by now or still in flight
+    if( _position_request )
+    {
+        void* reply = nullptr;
+        xcb_generic_error_t* error = nullptr;
+        if( xcb_poll_for_reply( _connection, _position_request->sequence, &reply, &error ) )
+        {
+            if( auto coordinates = static_cast<xcb_translate_coordinates_reply_t*>( reply ) )
+            {
+                auto& geometry = _pending_configure ? *_pending_configure : _pending_configure.emplace( CurrentGeometry() );
+                if( !_pending_configure_time ) _pending_configure_time = dispatched;
+                geometry.x = coordinates->dst_x;
+                geometry.y = coordinates->dst_y;
+                free( reply );
             }
-            case XCB_FOCUS_IN: { _events.emplace_back( new WindowFocusEvent( this ) ); break; }
-            case XCB_FOCUS_OUT: { _events.emplace_back( new WindowUnfocusEvent( this ) ); break; }
-            //-----------------------------------------------------------------------------------//
-            //                                   KEYBOARD                                        //
-            //-----------------------------------------------------------------------------------//
-            case XCB_KEY_PRESS:
+            free( error );
+            _position_request.reset();
+        }
+    }
+
+    // an offline window has no server to ask and keeps the last known position
+    if( std::exchange( _position_stale, false ) && _connection )
+    {
+        if( _position_request ) xcb_discard_reply( _connection, _position_request->sequence );
+        _position_request = xcb_translate_coordinates( _connection, _window, _root, 0, 0 );
+        xcb_flush( _connection );
+    }
+
+    if( _pending_configure && *_pending_configure != CurrentGeometry() )
+    {
+        const auto& [x, y, width, height] = *_pending_configure;
+        EmitAt<WindowConfigureEvent>( *_pending_configure_time, x, y, width, height );
+        _properties.posx   = x;
+        _properties.posy   = y;
+        _properties.width  = width;
+        _properties.height = height;
+    }
+    _pending_configure.reset();
+    _pending_configure_time.reset();
+
+    // a fetch that finished may let property changes go again
+    if( _selection )
+    {
+        _selection->Update( clock::now() );
+        UpdateEventMask();
+    }
+
+    if( _fullscreen_output ) UpdateOutput( dispatched );
+
+    // every complete run seen this poll goes out as one event; a run still arriving stays
+    // pending, and rects outside a window that just shrank are of no use to anyone
+    if( _damage_time )
+    {
+        _damage.clip( _properties.width, _properties.height );
+        if( !_damage.empty() ) EmitAt<WindowDamageEvent>( *_damage_time, _damage.rects() );
+        _damage.clear();
+        _damage_time.reset();
+    }
+}
+
+void XCBWindow::FlushMotion()
+{
+    if( _pending_motion )
+    {
+        EmitAt<MouseMoveEvent>( _pending_motion->local_time, _pending_motion->x, _pending_motion->y );
+        _pending_motion.reset();
+    }
+    if( _pending_raw_motion )
+    {
+        EmitAt<MouseRawMotionEvent>( _pending_raw_motion->time, _pending_raw_motion->dx, _pending_raw_motion->dy );
+        _pending_raw_motion.reset();
+    }
+    if( _pending_scroll )
+    {
+        const auto& scroll = *_pending_scroll;
+        EmitAt<MouseSmoothScrollEvent>( scroll.time, scroll.x, scroll.y, scroll.dx, scroll.dy );
+        _pending_scroll.reset();
+    }
+}
+
+void XCBWindow::TrackPointer( double x, double y, xcb_timestamp_t time )
+{
+    const pointer_sample_t sample
+    {
+        static_cast<int16_t>( std::floor( x ) ), static_cast<int16_t>( std::floor( y ) ), time, _event_time,
+        static_cast<float>( x ), static_cast<float>( y )
+    };
+    _motion_history.push_back( sample );
+    if( _coalesce_motion ) _pending_motion = sample;
+    else Emit<MouseMoveEvent>( sample.x, sample.y );
+}
+
+template<typename E, typename... Args>
+void XCBWindow::EmitAt( clock::time_point time, Args&&... args )
+{
+    if( _typed_events ) return event_record<E>::append( *_typed_events, time, std::forward<Args>( args )... );
+    _events.emplace_back( new( *_event_pool ) pooled<timestamped<E>>( time, this, std::forward<Args>( args )... ) );
+}
+
+template<typename E, typename... Args>
+void XCBWindow::Emit( Args&&... args )
+{
+    EmitAt<E>( _event_time, std::forward<Args>( args )... );
+}
+
+window_geometry_t XCBWindow::CurrentGeometry() const
+{
+    return window_geometry_t{ _properties.posx, _properties.posy, _properties.width, _properties.height };
+}
+
+void XCBWindow::TranslateEvent( const queued_event_t& queued )
+{
+    const auto event = queued.event;
+    const auto xinput_opcode = _display->XInputOpcode();
+    if( const auto server_time = event_timestamp( event, xinput_opcode ) )
+    {
+        _server_time = *server_time;
+        _event_time = _display->ServerClock().convert( *server_time, queued.received );
+        _latency.server_to_dequeue.record( queued.received - _event_time );
+    }
+    else _event_time = queued.received;
+
+    // motion of any kind keeps accumulating; everything else flushes it to keep events in order
+    const auto response_type = event->response_type & ~SERVER_USER_MASK;
+    const auto generic       = reinterpret_cast<xcb_ge_generic_event_t*>( event );
+    const bool motion        = response_type == XCB_MOTION_NOTIFY
+                            || ( response_type == XCB_GE_GENERIC && xinput_opcode != 0 && generic->extension == xinput_opcode
+                                 && ( generic->event_type == XCB_INPUT_MOTION || generic->event_type == XCB_INPUT_RAW_MOTION ) );
+    if( !motion ) FlushMotion();
+
+    switch( response_type )
+    {
+        //-----------------------------------------------------------------------------------//
+        //                                   WINDOW                                          //
+        //-----------------------------------------------------------------------------------//
+        case XCB_DESTROY_NOTIFY: { Emit<WindowCloseEvent>(); break; }
+        case XCB_EXPOSE:
+        {
+            // one uncover arrives as a run of rects counting down to 0; repaint once for all of it
+            auto expose = reinterpret_cast<xcb_expose_event_t*>( event );
+            _damage.add( { expose->x, expose->y, expose->width, expose->height } );
+            if( expose->count == 0 ) _damage_time = _event_time;
+            break;
+        }
+        case XCB_CLIENT_MESSAGE:
+        {
+            auto client_message = reinterpret_cast<xcb_client_message_event_t*>( event );
+            if( client_message->data.data32[0] == _window_delete_protocol )
             {
-                auto key_press    = reinterpret_cast<xcb_key_press_event_t*>( event );
-                auto key          = keymap.symbol( key_press->detail );
-                auto modified_key = keymap.symbol( key_press->detail, key_press->state );
-                auto mod          = keymap.mod( key, key_press->state, true );
-                _events.emplace_back( new KeyDownEvent( this, key, modified_key, mod ) );
-                break;
+                Emit<WindowCloseEvent>();
             }
-            case XCB_KEY_RELEASE:
+            break;
+        }
+        case XCB_REPARENT_NOTIFY:
+        {
+            auto reparent = reinterpret_cast<xcb_reparent_notify_event_t*>( event );
+            if( reparent->window == _window ) _parent = reparent->parent;
+            break;
+        }
+        case XCB_CONFIGURE_NOTIFY:
+        {
+            auto configure = reinterpret_cast<xcb_configure_notify_event_t*>( event );
+            if( configure->window != _window ) break;
+
+            auto& geometry = _pending_configure ? *_pending_configure : _pending_configure.emplace( CurrentGeometry() );
+            _pending_configure_time = _event_time;
+            geometry.width  = configure->width;
+            geometry.height = configure->height;
+
+            // synthetic notifies from the window manager carry root coordinates, as do real
+            // ones while we are still parented to the root; anything else is frame-relative
+            if( ( event->response_type & SERVER_USER_MASK ) || _parent == _root )
             {
-                auto key_release  = reinterpret_cast<xcb_key_release_event_t*>( event );
-                auto key          = keymap.symbol( key_release->detail );
-                auto modified_key = keymap.symbol( key_release->detail, key_release->state );
-                auto mod          = keymap.mod( key, key_release->state, false );
-                _events.emplace_back( new KeyUpEvent( this, key, modified_key, mod ) );
-                break;
+                geometry.x     = configure->x;
+                geometry.y     = configure->y;
+                _position_stale = false;
+
+                // a translation asked for before this would land after it and undo it
+                if( _position_request ) xcb_discard_reply( _connection, std::exchange( _position_request, std::nullopt )->sequence );
             }
-            //-----------------------------------------------------------------------------------//
-            //                                   MOUSE                                           //
-            //-----------------------------------------------------------------------------------//
-            case XCB_BUTTON_PRESS:
+            else _position_stale = true;
+            break;
+        }
+        case XCB_PROPERTY_NOTIFY:
+        case XCB_SELECTION_REQUEST:
+        case XCB_SELECTION_NOTIFY:
+        case XCB_SELECTION_CLEAR: { if( _selection ) _selection->HandleEvent( event ); break; }
+        case XCB_FOCUS_IN: { Emit<WindowFocusEvent>(); break; }
+        case XCB_FOCUS_OUT: { Emit<WindowUnfocusEvent>(); break; }
+        //-----------------------------------------------------------------------------------//
+        //                                   KEYBOARD                                        //
+        //-----------------------------------------------------------------------------------//
+        case XCB_KEY_PRESS:
+        {
+            auto key_press    = reinterpret_cast<xcb_key_press_event_t*>( event );
+            auto key          = _display->Keymap().symbol( key_press->detail );
+            auto modified_key = _display->Keymap().symbol( key_press->detail, key_press->state );
+            auto mod          = _display->Keymap().mod( key, key_press->state, true );
+            Emit<KeyDownEvent>( key, modified_key, mod );
+            break;
+        }
+        case XCB_KEY_RELEASE:
+        {
+            auto key_release  = reinterpret_cast<xcb_key_release_event_t*>( event );
+            auto key          = _display->Keymap().symbol( key_release->detail );
+            auto modified_key = _display->Keymap().symbol( key_release->detail, key_release->state );
+            auto mod          = _display->Keymap().mod( key, key_release->state, false );
+            Emit<KeyUpEvent>( key, modified_key, mod );
+            break;
+        }
+        //-----------------------------------------------------------------------------------//
+        //                                   MOUSE                                           //
+        //-----------------------------------------------------------------------------------//
+        case XCB_BUTTON_PRESS:
+        {
+            auto button_press = reinterpret_cast<xcb_button_press_event_t*>( event );
+            // wheel buttons are emulated from the scroll valuators, which are reported already
+            const bool smooth_scroll = ( _pointer_input & POINTER_PRECISE ) && !_display->XInput().scroll_valuators.empty();
+            if( button_press->same_screen )
             {
-                auto button_press = reinterpret_cast<xcb_button_press_event_t*>( event );
-                if( button_press->same_screen )
+                auto button = MOUSE_None;
+                switch( button_press->detail )
                 {
-                    auto button = MOUSE_None;
-                    switch( button_press->detail )
-                    {
-                        case 1: button = MOUSE_Left; break;
-                        case 2: button = MOUSE_Middle; break;
-                        case 3: button = MOUSE_Right; break;
-                        case 4: _events.emplace_back( new MouseScrollEvent( this, button_press->event_x, button_press->event_y, 1 ) ); break;
-                        case 5: _events.emplace_back( new MouseScrollEvent( this, button_press->event_x, button_press->event_y, -1 ) ); break;
-                        case 8: button = MOUSE_Backward; break;
-                        case 9: button = MOUSE_Forward; break;
-                        default: break;
-                    }
-
-                    if( button != MOUSE_None ) _events.emplace_back( new MouseDownEvent( this, button_press->event_x, button_press->event_y, button ) );
+                    case 1: button = MOUSE_Left; break;
+                    case 2: button = MOUSE_Middle; break;
+                    case 3: button = MOUSE_Right; break;
+                    case 4: if( !smooth_scroll ) Emit<MouseScrollEvent>( button_press->event_x, button_press->event_y, 1 ); break;
+                    case 5: if( !smooth_scroll ) Emit<MouseScrollEvent>( button_press->event_x, button_press->event_y, -1 ); break;
+                    case 8: button = MOUSE_Backward; break;
+                    case 9: button = MOUSE_Forward; break;
+                    default: break;
                 }
-                break;
+
+                if( button != MOUSE_None ) Emit<MouseDownEvent>( button_press->event_x, button_press->event_y, button );
             }
-            case XCB_BUTTON_RELEASE:
+            break;
+        }
+        case XCB_BUTTON_RELEASE:
+        {
+            auto button_release = reinterpret_cast<xcb_button_release_event_t*>( event );
+            if( button_release->same_screen && button_release-> detail != 4 && button_release->detail != 5 )
             {
-                auto button_release = reinterpret_cast<xcb_button_release_event_t*>( event );
-                if( button_release->same_screen && button_release-> detail != 4 && button_release->detail != 5 )
+                auto button = MOUSE_None;
+                switch( button_release->detail )
                 {
-                    auto button = MOUSE_None;
-                    switch( button_release->detail )
-                    {
-                        case 1: button = MOUSE_Left; break;
-                        case 2: button = MOUSE_Middle; break;
-                        case 3: button = MOUSE_Right; break;
-                        case 4: _events.emplace_back( new MouseScrollEvent( this, button_release->event_x, button_release->event_y, 1 ) ); break;
-                        case 5: _events.emplace_back( new MouseScrollEvent( this, button_release->event_x, button_release->event_y, -1 ) ); break;
-                        case 8: button = MOUSE_Backward; break;
-                        case 9: button = MOUSE_Forward; break;
-                        default: break;
-                    }
-
-                    if( button != MOUSE_None ) _events.emplace_back( new MouseUpEvent( this, button_release->event_x, button_release->event_y, button ) );
+                    case 1: button = MOUSE_Left; break;
+                    case 2: button = MOUSE_Middle; break;
+                    case 3: button = MOUSE_Right; break;
+                    case 4: Emit<MouseScrollEvent>( button_release->event_x, button_release->event_y, 1 ); break;
+                    case 5: Emit<MouseScrollEvent>( button_release->event_x, button_release->event_y, -1 ); break;
+                    case 8: button = MOUSE_Backward; break;
+                    case 9: button = MOUSE_Forward; break;
+                    default: break;
                 }
-                break;
+
+                if( button != MOUSE_None ) Emit<MouseUpEvent>( button_release->event_x, button_release->event_y, button );
             }
-            case XCB_MOTION_NOTIFY:
+            break;
+        }
+        case XCB_MOTION_NOTIFY:
+        {
+            auto motion = reinterpret_cast<xcb_motion_notify_event_t*>( event );
+            if( motion->same_screen ) TrackPointer( motion->event_x, motion->event_y, motion->time );
+            break;
+        }
+        //-----------------------------------------------------------------------------------//
+        //                                   OTHER                                           //
+        //-----------------------------------------------------------------------------------//
+        case XCB_GE_GENERIC:
+        {
+            if( xinput_opcode != 0 && generic->extension == xinput_opcode ) TranslateXInput( generic );
+            else if( _present_event != 0 && generic->extension == _display->PresentOpcode() ) TranslatePresent( generic, queued.received );
+            else LOG_F( INFO, "Generic event: %d", static_cast<int>( generic->extension ) );
+            break;
+        }
+        default:            LOG_F( WARNING, "Unhandled event: %d", static_cast<int>( response_type ) ); break;
+    }
+}
+
+void XCBWindow::TranslatePresent( const xcb_ge_generic_event_t* event, clock::time_point received )
+{
+    switch( event->event_type )
+    {
+        case XCB_PRESENT_EVENT_COMPLETE_NOTIFY:
+        {
+            auto complete = reinterpret_cast<const xcb_present_complete_notify_event_t*>( event );
+            if( complete->kind == XCB_PRESENT_COMPLETE_KIND_PIXMAP && complete->mode == XCB_PRESENT_COMPLETE_MODE_SKIP ) _frames.skipped();
+            else _frames.vblank( complete->ust, complete->msc, received );
+
+            // calibration needs a second vblank, which nobody else is going to ask for
+            if( complete->kind == XCB_PRESENT_COMPLETE_KIND_NOTIFY_MSC && complete->serial == _present_serial )
             {
-                auto motion = reinterpret_cast<xcb_motion_notify_event_t*>( event );
-                if( motion->same_screen ) _events.emplace_back( new MouseMoveEvent( this, motion->event_x, motion->event_y ) );
-                break;
+                _requested_msc.reset();
+                if( !_frames.calibrated() )
+                {
+                    RequestVblank( complete->msc + 1 );
+                    xcb_flush( _connection );
+                }
             }
-            //-----------------------------------------------------------------------------------//
-            //                                   OTHER                                           //
-            //-----------------------------------------------------------------------------------//
-            case XCB_GE_GENERIC: LOG_F( INFO, "Generic event: %d", response_type ); break;
-            default:            LOG_F( WARNING, "Unhandled event: %d", static_cast<int>( response_type ) ); break;
+            break;
+        }
+        case XCB_PRESENT_EVENT_IDLE_NOTIFY:
+        {
+            _frames.idle( reinterpret_cast<const xcb_present_idle_notify_event_t*>( event )->serial );
+            break;
         }
-        free( event );
+        default: break;
     }
+}
 
-    return aer::Window::PollEvents( events, clear_unhandled );
+void XCBWindow::TranslateXInput( const xcb_ge_generic_event_t* event )
+{
+    // valuator values are listed only for the bits set in the mask, in bit order
+    const auto for_each_valuator = []( const uint32_t* mask, int mask_length, const xcb_input_fp3232_t* values, auto&& fn )
+    {
+        for( int bit = 0, index = 0; bit < mask_length * 32; ++bit )
+        {
+            if( mask[bit / 32] & ( 1u << ( bit % 32 ) ) ) fn( bit, xinput::to_double( values[index++] ) );
+        }
+    };
+
+    switch( event->event_type )
+    {
+        case XCB_INPUT_RAW_MOTION:
+        {
+            // valuators 0 and 1 of a master pointer are x and y; raw values skip acceleration
+            auto raw     = reinterpret_cast<const xcb_input_raw_motion_event_t*>( event );
+            auto& motion = _pending_raw_motion ? *_pending_raw_motion : _pending_raw_motion.emplace();
+            motion.time  = _event_time;
+            for_each_valuator( xcb_input_raw_button_press_valuator_mask( raw ), xcb_input_raw_button_press_valuator_mask_length( raw ),
+                               xcb_input_raw_button_press_axisvalues_raw( raw ), [&]( int number, double value )
+            {
+                if( number == 0 ) motion.dx += value;
+                if( number == 1 ) motion.dy += value;
+            });
+            break;
+        }
+        case XCB_INPUT_MOTION:
+        {
+            auto motion    = reinterpret_cast<const xcb_input_motion_event_t*>( event );
+            auto& devices  = _display->XInput();
+            const double x = xinput::to_double( motion->event_x );
+            const double y = xinput::to_double( motion->event_y );
+
+            bool moved = false;
+            for_each_valuator( xcb_input_button_press_valuator_mask( motion ), xcb_input_button_press_valuator_mask_length( motion ),
+                               xcb_input_button_press_axisvalues( motion ), [&]( int number, double value )
+            {
+                moved |= number < 2;
+                auto valuator = devices.find_scroll( motion->deviceid, number );
+                if( !valuator ) return;
+                const auto last = std::exchange( valuator->last, value );
+                if( !last ) return;
+
+                auto& scroll = _pending_scroll ? *_pending_scroll : _pending_scroll.emplace();
+                const double detents = ( value - *last ) / valuator->increment;
+                if( valuator->horizontal ) scroll.dx += detents;
+                else scroll.dy -= detents;
+                scroll.x    = static_cast<int16_t>( std::floor( x ) );
+                scroll.y    = static_cast<int16_t>( std::floor( y ) );
+                scroll.time = _event_time;
+            });
+
+            // scrolling alone also arrives as XI_Motion, which core input never reported as motion
+            if( moved ) TrackPointer( x, y, motion->time );
+            break;
+        }
+        case XCB_INPUT_ENTER: _display->XInput().reset_scroll(); break;
+        case XCB_INPUT_DEVICE_CHANGED:
+        {
+            // the connection applied it while routing; a replay only has the recorded copy
+            if( !_connection ) _display->XInput().update_device( reinterpret_cast<const xcb_input_device_changed_event_t*>( event ) );
+            break;
+        }
+        default: break;
+    }
 }
 
-} // namespace aer
\ No newline at end of file
+} // namespace aer
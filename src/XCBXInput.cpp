@@ -0,0 +1,91 @@
+#include <Graphics/XCBXInput.h>
+#include <Graphics/XCBConnection.h>
+
+#include <algorithm>
+
+namespace aer::xcb
+{
+
+xinput::xinput( xcb_connection_t* connection )
+{
+    // requests to a missing extension would close the connection, so presence comes first
+    round_trip_count.fetch_add( 1, std::memory_order_relaxed );
+    auto extension = xcb_get_extension_data( connection, &xcb_input_id );
+    if( !extension || !extension->present ) return;
+
+    // the version has to be announced before the server reports 2.1 scroll classes; both
+    // requests go out in one flush
+    auto version = xcb_input_xi_query_version( connection, 2, 2 );
+    auto devices = xcb_input_xi_query_device( connection, XCB_INPUT_DEVICE_ALL_MASTER );
+    auto version_reply = wait_for_reply<xcb_input_xi_query_version_reply_t>( connection, version.sequence );
+    auto devices_reply = wait_for_reply<xcb_input_xi_query_device_reply_t>( connection, devices.sequence );
+
+    if( version_reply && ( version_reply->major_version > 2 || ( version_reply->major_version == 2 && version_reply->minor_version >= 1 ) ) && devices_reply )
+    {
+        opcode = extension->major_opcode;
+        for( auto info = xcb_input_xi_query_device_infos_iterator( devices_reply ); info.rem; xcb_input_xi_device_info_next( &info ) )
+        {
+            if( info.data->type == XCB_INPUT_DEVICE_TYPE_MASTER_POINTER )
+            {
+                add_classes( info.data->deviceid, xcb_input_xi_device_info_classes_iterator( info.data ) );
+            }
+        }
+    }
+    LOG_IF_F( INFO, opcode == 0, "XInput 2.1 unavailable, pointer input stays on core events" );
+    free( version_reply );
+    free( devices_reply );
+}
+
+xinput::xinput( uint8_t in_opcode, std::span<const scroll_valuator_t> valuators )
+:   opcode( in_opcode ),
+    scroll_valuators( valuators.begin(), valuators.end() )
+{
+    reset_scroll();
+}
+
+void xinput::add_classes( xcb_input_device_id_t device, xcb_input_device_class_iterator_t classes )
+{
+    for( ; classes.rem; xcb_input_device_class_next( &classes ) )
+    {
+        if( classes.data->type != XCB_INPUT_DEVICE_CLASS_TYPE_SCROLL ) continue;
+        if( scroll_valuators.size() == max_scroll_valuators ) break;
+
+        auto scroll = reinterpret_cast<const xcb_input_scroll_class_t*>( classes.data );
+        const auto increment = to_double( scroll->increment );
+        scroll_valuators.push_back
+        ({
+            device, scroll->number, scroll->scroll_type == XCB_INPUT_SCROLL_TYPE_HORIZONTAL,
+            increment != 0.0 ? increment : 1.0, std::nullopt
+        });
+    }
+}
+
+scroll_valuator_t* xinput::find_scroll( xcb_input_device_id_t device, uint16_t number )
+{
+    for( auto& valuator : scroll_valuators ) if( valuator.device == device && valuator.number == number ) return &valuator;
+    return nullptr;
+}
+
+void xinput::update_device( const xcb_input_device_changed_event_t* changed )
+{
+    std::erase_if( scroll_valuators, [&]( auto& valuator ) { return valuator.device == changed->deviceid; } );
+    add_classes( changed->deviceid, xcb_input_device_changed_classes_iterator( changed ) );
+    reset_scroll();
+}
+
+void xinput::reset_scroll()
+{
+    for( auto& valuator : scroll_valuators ) valuator.last.reset();
+}
+
+void xinput_select( xcb_connection_t* connection, xcb_window_t window, uint32_t mask )
+{
+    struct
+    {
+        xcb_input_event_mask_t  header;
+        uint32_t                mask;
+    } select{ { XCB_INPUT_DEVICE_ALL_MASTER, 1 }, mask };
+    xcb_input_xi_select_events( connection, window, 1, &select.header );
+}
+
+} // namespace aer::xcb
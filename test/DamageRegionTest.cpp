@@ -0,0 +1,143 @@
+// Exercises damage_region: merging of touching and overlapping rects, the cap on the rect
+// count, clipping after the window shrinks, and the empty region. Needs no X server.
+//
+//  usage: aer_linux_damage_region_test
+
+#include <Graphics/DamageRegion.h>
+
+#include "Expect.h"
+
+#include <vector>
+
+namespace aer::test
+{
+
+bool covers( const framebuffer_rect_t& outer, const framebuffer_rect_t& inner )
+{
+    return outer.x <= inner.x && outer.y <= inner.y
+        && int64_t{ outer.x } + outer.width  >= int64_t{ inner.x } + inner.width
+        && int64_t{ outer.y } + outer.height >= int64_t{ inner.y } + inner.height;
+}
+
+// every pixel of rect is inside one rect of region; exact for the grid aligned rects used here
+bool covered( const damage_region& region, const framebuffer_rect_t& rect )
+{
+    for( int32_t y = rect.y; y < rect.y + static_cast<int32_t>( rect.height ); ++y )
+    {
+        for( int32_t x = rect.x; x < rect.x + static_cast<int32_t>( rect.width ); ++x )
+        {
+            bool inside = false;
+            for( auto& part : region.rects() ) inside |= covers( part, { x, y, 1, 1 } );
+            if( !inside ) return false;
+        }
+    }
+    return true;
+}
+
+bool operator==( const framebuffer_rect_t& a, const framebuffer_rect_t& b )
+{
+    return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+}
+
+void run_empty()
+{
+    damage_region region;
+    expect( region.empty() && region.area() == 0, "a new region is empty" );
+    expect( region.bounds() == framebuffer_rect_t{}, "an empty region has empty bounds" );
+
+    region.add( { 10, 10, 0, 5 } );
+    region.add( { 10, 10, 5, 0 } );
+    expect( region.empty(), "rects without area are ignored" );
+
+    region.clip( 100, 100 );
+    expect( region.empty(), "clipping an empty region" );
+
+    region.add( { 1, 2, 3, 4 } );
+    region.clear();
+    expect( region.empty() && region.rects().empty(), "clear empties it" );
+}
+
+void run_merge()
+{
+    damage_region region;
+    region.add( { 0, 0, 10, 10 } );
+    region.add( { 10, 0, 10, 10 } );
+    expect( region.rects().size() == 1 && region.bounds() == framebuffer_rect_t{ 0, 0, 20, 10 }, "side by side rects merge" );
+
+    region.add( { 5, 5, 10, 10 } );
+    expect( region.rects().size() == 1 && region.bounds() == framebuffer_rect_t{ 0, 0, 20, 15 }, "an overlap costing no area merges" );
+
+    region.add( { 15, 10, 10, 10 } );
+    expect( region.rects().size() == 2, "an overlap that would grow the box stays apart" );
+    region.add( { 2, 2, 4, 4 } );
+    expect( region.rects().size() == 2, "a contained rect is absorbed" );
+
+    // a rect that fills the gap makes the whole box free, folding the others in with it
+    region.add( { 0, 10, 25, 10 } );
+    expect( region.rects().size() == 1 && region.bounds() == framebuffer_rect_t{ 0, 0, 25, 20 }, "merges cascade" );
+    expect( region.area() == 500, "the merged box" );
+
+    damage_region apart;
+    apart.add( { 0, 0, 10, 10 } );
+    apart.add( { 50, 50, 10, 10 } );
+    expect( apart.rects().size() == 2 && apart.area() == 200, "distant rects stay separate" );
+}
+
+void run_overflow()
+{
+    // a grid of isolated cells, more than the cap allows
+    damage_region region;
+    std::vector<framebuffer_rect_t> added;
+    for( int32_t row = 0; row < 8; ++row )
+    {
+        for( int32_t column = 0; column < 8; ++column )
+        {
+            added.push_back( { column * 20, row * 20, 4, 4 } );
+            region.add( added.back() );
+            expect( region.rects().size() <= damage_region::max_rects, "never more rects than the cap" );
+        }
+    }
+    expect( region.rects().size() == damage_region::max_rects, "the cap is used before merging further" );
+    expect( region.bounds() == framebuffer_rect_t{ 0, 0, 144, 144 }, "bounds are those of everything added" );
+
+    bool all_covered = true;
+    for( auto& rect : added ) all_covered &= covered( region, rect );
+    expect( all_covered, "merging never loses damage" );
+    expect( region.area() < uint64_t{ 144 } * 144, "merged pairs are cheaper than the bounding box" );
+
+    // a rect over everything collapses the region into its bounding box
+    region.add( { 0, 0, 144, 144 } );
+    expect( region.rects().size() == 1 && region.bounds() == framebuffer_rect_t{ 0, 0, 144, 144 }, "overflow to the bounding box" );
+}
+
+void run_clip()
+{
+    damage_region region;
+    region.add( { -5, -5, 20, 20 } );
+    region.add( { 90, 40, 30, 10 } );
+    region.add( { 200, 200, 10, 10 } );
+
+    // the window shrank to 100 x 50 before the damage was painted
+    region.clip( 100, 50 );
+    expect( region.rects().size() == 2, "a rect outside the window is dropped" );
+
+    bool clipped = true;
+    for( auto& rect : region.rects() ) clipped &= covers( { 0, 0, 100, 50 }, rect );
+    expect( clipped, "what remains lies inside the window" );
+    expect( covered( region, { 0, 0, 15, 15 } ) && covered( region, { 90, 40, 10, 10 } ), "the inside parts are kept" );
+    expect( region.area() == 15 * 15 + 10 * 10, "nothing beyond the inside parts" );
+
+    region.clip( 0, 0 );
+    expect( region.empty(), "a window with no area has no damage" );
+}
+
+} // namespace aer::test
+
+int main()
+{
+    aer::test::run_empty();
+    aer::test::run_merge();
+    aer::test::run_overflow();
+    aer::test::run_clip();
+    return aer::test::finish();
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <Base/Base.h>
+
+// the tests are plain executables: every failed check is logged, and main returns the count
+namespace aer::test
+{
+
+inline int failures = 0;
+
+inline void expect( bool condition, const char* what )
+{
+    if( condition ) return;
+    LOG_F( ERROR, "FAILED: %s", what );
+    ++failures;
+}
+
+inline int finish()
+{
+    if( failures ) LOG_F( ERROR, "%d checks failed", failures );
+    return failures ? 1 : 0;
+}
+
+} // namespace aer::test
@@ -0,0 +1,122 @@
+// Drives frame_scheduler with synthetic CompleteNotify sequences: steady vblanks, stalled and
+// backwards timestamps, counter jumps and a change of refresh rate. Needs no X server.
+//
+//  usage: aer_linux_frame_scheduler_test
+
+#include <Graphics/XCBFrameScheduler.h>
+
+#include "Expect.h"
+
+#include <chrono>
+
+namespace aer::test
+{
+
+using namespace std::chrono_literals;
+using xcb::frame_scheduler;
+
+// a local server: UST is steady_clock in microseconds, and notifies arrive right away
+struct display_t
+{
+    frame_scheduler scheduler;
+    uint64_t        ust = 1'000'000;
+    uint64_t        msc = 100;
+
+    static frame_scheduler::clock::time_point at( uint64_t ust ) { return frame_scheduler::clock::time_point( std::chrono::microseconds( ust ) ); }
+
+    void vblank() { scheduler.vblank( ust, msc, at( ust ) ); }
+    void advance( uint64_t vblanks, uint64_t interval_us )
+    {
+        for( uint64_t i = 0; i < vblanks; ++i )
+        {
+            ust += interval_us;
+            msc += 1;
+            vblank();
+        }
+    }
+};
+
+void run_steady()
+{
+    display_t display;
+    display.vblank();
+    expect( !display.scheduler.calibrated(), "one vblank gives no interval" );
+
+    const auto now = display_t::at( display.ust );
+    const auto early = display.scheduler.next_frame( now, 4ms );
+    expect( early.msc == 101 && early.start == now, "before calibration rendering starts right away" );
+
+    display.advance( 10, 16667 );
+    expect( display.scheduler.refresh_interval() == 16667us, "steady 60 Hz intervals" );
+    expect( display.scheduler.predict( display.msc + 10 ) == display_t::at( display.ust + 10 * 16667 ), "prediction follows the interval" );
+
+    const auto last = display_t::at( display.ust );
+    const auto target = display.scheduler.next_frame( last + 1ms, 4ms );
+    expect( target.msc == display.msc + 1, "a short budget makes the next vblank" );
+    expect( target.start == target.vblank - 4ms, "rendering starts one budget ahead" );
+    expect( display.scheduler.next_frame( last + 1ms, 16ms ).msc == display.msc + 2, "a long budget skips a vblank" );
+
+    expect( display.scheduler.frame_done( target, target.vblank - 1ms ) == 0, "a frame in time misses nothing" );
+    expect( display.scheduler.frame_done( target, target.vblank + 20ms ) == 2, "20 ms late at 60 Hz misses two vblanks" );
+    expect( display.scheduler.frames() == 2 && display.scheduler.missed_frames() == 2, "frame statistics" );
+}
+
+void run_glitches()
+{
+    // the first interval measures nothing, so there is still no estimate to divide by
+    display_t display;
+    display.vblank();
+    display.msc += 1;
+    display.vblank();
+    expect( !display.scheduler.calibrated(), "a zero first interval does not calibrate" );
+    display.scheduler.next_frame( display_t::at( display.ust ), 4ms );
+    display.advance( 4, 16667 );
+    expect( display.scheduler.refresh_interval() == 16667us, "calibrates from the next interval" );
+
+    // the counter moves while the time stands still, then goes backwards
+    display.msc += 1;
+    display.vblank();
+    expect( display.scheduler.refresh_interval() == 16667us, "a stalled timestamp leaves the interval alone" );
+    display.msc += 1;
+    display.ust -= 5000;
+    display.vblank();
+    expect( display.scheduler.refresh_interval() == 16667us, "a backwards timestamp leaves the interval alone" );
+    expect( display.scheduler.last_msc() == display.msc, "a rejected sample still moves the anchor" );
+
+    const auto now = display_t::at( display.ust ) + 1ms;
+    const auto target = display.scheduler.next_frame( now, 4ms );
+    expect( target.vblank > now, "prediction after a rejected sample" );
+    display.scheduler.frame_done( target, target.vblank + 1ms );
+
+    // a fake vblank fallback or crtc switch moves the counter far ahead within one frame
+    display.advance( 2, 16667 );
+    display.msc += 1000;
+    display.ust += 16667;
+    display.vblank();
+    expect( display.scheduler.refresh_interval() == 16667us, "a counter jump leaves the interval alone" );
+    display.advance( 1, 16667 );
+    expect( display.scheduler.refresh_interval() == 16667us, "normal vblanks resume after the jump" );
+
+    // a new mode on the same crtc: one outlier is ignored, the second replaces the estimate
+    display.advance( 1, 6944 );
+    expect( display.scheduler.refresh_interval() == 16667us, "a single short interval is an outlier" );
+    display.advance( 1, 6944 );
+    expect( display.scheduler.refresh_interval() == 6944us, "a second one is the new refresh rate" );
+    display.advance( 4, 6944 );
+    expect( display.scheduler.refresh_interval() == 6944us, "and the estimate holds" );
+
+    // a counter that restarts belongs to another crtc
+    display.msc = 5;
+    display.ust += 6944;
+    display.vblank();
+    expect( !display.scheduler.calibrated(), "a lower counter restarts calibration" );
+}
+
+} // namespace aer::test
+
+int main()
+{
+    aer::test::run_steady();
+    aer::test::run_glitches();
+    return aer::test::finish();
+}
@@ -0,0 +1,149 @@
+// Exercises keycode_map lookups and the incremental rebuild of xcb::keyboard_map on
+// MappingNotify: a partial keycode range, and a refresh merging with one still in flight. Replies
+// are built in memory and requests go to a connection that failed to open, so no X server is
+// needed.
+//
+//  usage: aer_linux_keyboard_map_test
+
+#include <Graphics/XCBConnection.h>
+#include <Input/KeyboardMap.h>
+
+#include "Expect.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <X11/keysym.h>
+
+namespace aer::test
+{
+
+// exposes the rows a refresh asked for, and takes replies the way poll() would
+struct test_keyboard_map : xcb::keyboard_map
+{
+    test_keyboard_map( const code_map& codes, xcb_connection_t* connection )
+    :   keyboard_map( codes )
+    {
+        _connection = connection;
+    }
+
+    bool    pending() const         { return _pending.has_value(); }
+    uint8_t pending_first() const   { return _pending_first; }
+    uint8_t pending_count() const   { return _pending_count; }
+
+    // a GetKeyboardMapping reply carrying rows for the pending range, malloc'ed like one off the wire
+    void reply( const std::vector<std::vector<uint32_t>>& rows, uint8_t keysyms_per_keycode )
+    {
+        const size_t length = rows.size() * keysyms_per_keycode;
+        auto reply = static_cast<xcb_get_keyboard_mapping_reply_t*>( calloc( 1, sizeof( xcb_get_keyboard_mapping_reply_t ) + length * sizeof( xcb_keysym_t ) ) );
+        reply->response_type       = 1;
+        reply->keysyms_per_keycode = keysyms_per_keycode;
+        reply->length              = static_cast<uint32_t>( length );
+        auto keysyms = reinterpret_cast<xcb_keysym_t*>( reply + 1 );
+        for( size_t i = 0; i < rows.size(); ++i ) std::memcpy( keysyms + i * keysyms_per_keycode, rows[i].data(), keysyms_per_keycode * sizeof( xcb_keysym_t ) );
+
+        _pending.reset();
+        apply( reply );
+    }
+};
+
+uint16_t mask( key::mod mod ) { return static_cast<uint16_t>( mod ); }
+
+keycode_map::code_map layout()
+{
+    keycode_map::code_map codes{};
+    codes[38] = { XK_a, XK_A };
+    codes[39] = { XK_s, XK_S };
+    codes[40] = { XK_d, XK_D };
+    codes[41] = { XK_f, XK_F };
+    codes[50] = { XK_Shift_L, XK_Shift_L };
+    codes[64] = { XK_Alt_L, XK_Meta_L };
+    codes[79] = { XK_KP_Home, XK_KP_7 };
+    return codes;
+}
+
+//-----------------------------------------------------------------------------------------------//
+//                                   LOOKUP                                                      //
+//-----------------------------------------------------------------------------------------------//
+void run_lookup()
+{
+    const keycode_map map( layout() );
+
+    expect( map.symbol( 38 ) == XK_a, "no modifier gives the base level" );
+    expect( map.symbol( 38, key::MOD_Shift ) == XK_a, "Shift alone keeps the base level" );
+    expect( map.symbol( 38, key::MOD_Shift | key::MOD_CapsLock ) == XK_A, "Shift with Caps_Lock gives the shifted level" );
+    expect( map.symbol( 79, key::MOD_NumLock ) == XK_KP_7, "Num_Lock selects the keypad digit" );
+    expect( map.symbol( 79, key::MOD_NumLock | key::MOD_Shift ) == XK_KP_Home, "Shift undoes Num_Lock on the keypad" );
+    expect( map.symbol( 200, key::MOD_Shift ) == KEY_Undefined, "an unmapped keycode has no symbol" );
+
+    expect( mask( map.mod( XK_Shift_L, 0, true ) ) == MODIFIER_SHIFT, "pressing Shift sets its bit" );
+    expect( mask( map.mod( XK_Shift_L, MODIFIER_SHIFT | MODIFIER_2, false ) ) == MODIFIER_2, "releasing Shift clears only its bit" );
+    expect( mask( map.mod( XK_Meta_L, 0, true ) ) == MODIFIER_1, "Meta shares Mod1 with Alt" );
+    expect( mask( map.mod( XK_a, MODIFIER_CONTROL, true ) ) == MODIFIER_CONTROL, "a plain key leaves the mask alone" );
+}
+
+//-----------------------------------------------------------------------------------------------//
+//                                   MAPPING NOTIFY                                              //
+//-----------------------------------------------------------------------------------------------//
+void run_partial()
+{
+    // xcb_connect hands back an errored connection on a bad display name, without any I/O
+    auto connection = xcb_connect( "not a display", nullptr );
+    test_keyboard_map map( layout(), connection );
+
+    map.refresh( 39, 2 );
+    expect( map.pending() && map.pending_first() == 39 && map.pending_count() == 2, "a refresh asks for the notified range only" );
+    expect( map.symbol( 39 ) == XK_s, "keys translate with the old rows until the reply arrives" );
+
+    // three keysyms per keycode, of which only two levels are kept
+    map.reply( { { XK_o, XK_O, XK_oslash }, { XK_e, XK_E, XK_eacute } }, 3 );
+    expect( map.symbol( 39 ) == XK_o && map.codes()[39][1] == XK_O, "the first row of the range is replaced" );
+    expect( map.symbol( 40 ) == XK_e && map.codes()[40][1] == XK_E, "the last row of the range is replaced" );
+    expect( map.symbol( 38 ) == XK_a && map.symbol( 41 ) == XK_f, "rows outside the range are kept" );
+    expect( map.symbol( 79, key::MOD_NumLock ) == XK_KP_7, "far rows are kept" );
+
+    // a reply with a single keysym per keycode leaves the shifted level empty
+    map.refresh( 41, 1 );
+    map.reply( { { XK_g } }, 1 );
+    expect( map.codes()[41][0] == XK_g && map.codes()[41][1] == KEY_Undefined, "levels the server did not send are cleared" );
+
+    xcb_disconnect( connection );
+}
+
+void run_merge()
+{
+    auto connection = xcb_connect( "not a display", nullptr );
+    test_keyboard_map map( layout(), connection );
+
+    // the second notify arrives before the reply to the first, above its range
+    map.refresh( 38, 1 );
+    map.refresh( 40, 2 );
+    expect( map.pending() && map.pending_first() == 38 && map.pending_count() == 4, "a second refresh spans both ranges" );
+    map.reply( { { XK_h, XK_H }, { XK_j, XK_J }, { XK_k, XK_K }, { XK_l, XK_L } }, 2 );
+    expect( map.symbol( 38 ) == XK_h && map.symbol( 39 ) == XK_j, "the merged reply fills the first range and the gap" );
+    expect( map.symbol( 40 ) == XK_k && map.symbol( 41 ) == XK_l, "the merged reply fills the second range" );
+    expect( map.symbol( 50 ) == XK_Shift_L, "rows past the merged range are kept" );
+
+    // and one below and inside it
+    map.refresh( 64, 1 );
+    map.refresh( 50, 1 );
+    map.refresh( 60, 2 );
+    expect( map.pending_first() == 50 && map.pending_count() == 15, "refreshes below and inside a pending range widen it once" );
+
+    // the poll that drops the request on a dead connection leaves the rows as they were
+    map.poll();
+    expect( !map.pending() && map.symbol( 64 ) == XK_Alt_L, "a failed request keeps the old rows" );
+
+    xcb_disconnect( connection );
+}
+
+} // namespace aer::test
+
+int main()
+{
+    aer::test::run_lookup();
+    aer::test::run_partial();
+    aer::test::run_merge();
+    return aer::test::finish();
+}
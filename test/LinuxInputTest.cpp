@@ -0,0 +1,287 @@
+// Feeds recorded evdev streams through pipes into LinuxInput and checks what comes out, through
+// both the event objects and the typed records. Needs neither devices nor an X server.
+//
+//  usage: aer_linux_input_test
+
+#include <Input/EventPool.h>
+#include <Input/LinuxInput.h>
+#include <Input/PointerEvents.h>
+#include <Input/TypedEvents.h>
+
+#include <Events/KeyEvents.h>
+#include <Events/MouseEvents.h>
+
+#include "Expect.h"
+
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <X11/keysym.h>
+
+// last: its KEY_* and BTN_* macros would otherwise rewrite aer's key names
+#include <linux/input.h>
+
+namespace aer::test
+{
+
+// a capture as it would come off a device node: records with kernel times, in report frames
+struct recording_t
+{
+    std::vector<input_event> records;
+    long                     usec = 0;
+
+    recording_t& add( uint16_t type, uint16_t code, int32_t value )
+    {
+        input_event event{};
+        event.input_event_sec  = 1;
+        event.input_event_usec = usec;
+        event.type             = type;
+        event.code             = code;
+        event.value            = value;
+        records.push_back( event );
+        return *this;
+    }
+
+    recording_t& report()
+    {
+        add( EV_SYN, SYN_REPORT, 0 );
+        usec += 1000;
+        return *this;
+    }
+
+    recording_t& key( uint16_t code, int32_t value ) { return add( EV_KEY, code, value ).report(); }
+};
+
+// one pipe per device; the read end is nonblocking like the device nodes Open() watches
+struct replay_t
+{
+    int fds[2] = { -1, -1 };
+
+    replay_t()
+    {
+        if( pipe2( fds, O_CLOEXEC ) != 0 ) ABORT_F( "Failed to create replay pipe: %s", strerror( errno ) );
+        fcntl( fds[0], F_SETFL, fcntl( fds[0], F_GETFL ) | O_NONBLOCK );
+    }
+    ~replay_t() { finish(); }
+
+    void send( const void* data, size_t size )
+    {
+        if( ::write( fds[1], data, size ) != static_cast<ssize_t>( size ) ) ABORT_F( "Short write to replay pipe" );
+    }
+    void send( const recording_t& recording ) { send( recording.records.data(), recording.records.size() * sizeof( input_event ) ); }
+    void finish() { if( fds[1] >= 0 ) close( std::exchange( fds[1], -1 ) ); }
+};
+
+//-----------------------------------------------------------------------------------------------//
+//                                   KEYBOARD                                                    //
+//-----------------------------------------------------------------------------------------------//
+void run_keys()
+{
+    ref_ptr<LinuxInput> input( new LinuxInput );
+    replay_t replay;
+    expect( input->AddDevice( replay.fds[0], true ) >= 0, "keyboard pipe is watched" );
+
+    recording_t recording;
+    recording.key( KEY_LEFTSHIFT, 1 ).key( KEY_A, 1 ).key( KEY_A, 0 ).key( KEY_LEFTSHIFT, 0 );
+    recording.key( KEY_CAPSLOCK, 1 ).key( KEY_CAPSLOCK, 0 ).key( KEY_A, 1 ).key( KEY_A, 2 ).key( KEY_A, 0 );
+    recording.key( KEY_NUMLOCK, 1 ).key( KEY_NUMLOCK, 0 ).key( KEY_KP7, 1 ).key( KEY_KP7, 0 );
+
+    // split the stream mid-record so the tail has to be carried into the next read
+    const auto bytes = reinterpret_cast<const std::byte*>( recording.records.data() );
+    const size_t size = recording.records.size() * sizeof( input_event );
+    const size_t split = 5 * sizeof( input_event ) + 3;
+
+    typed_events_t events;
+    replay.send( bytes, split );
+    input->PollEvents( events );
+    replay.send( bytes + split, size - split );
+    replay.finish();
+    input->PollEvents( events );
+    // the hang up is seen by the poll after the last records
+    input->PollEvents( events );
+
+    expect( events.mouse.empty() && events.window.empty(), "a keyboard emits key records only" );
+    expect( events.keys.size() == 13, "one record per key change, autorepeat included" );
+    if( events.keys.size() != 13 ) return;
+
+    const auto& shifted = events.keys[1];
+    expect( shifted.pressed && shifted.key == 'a', "A reports its base symbol" );
+    expect( ( shifted.mod & key::MOD_Shift ) != 0, "A pressed under Shift carries Shift" );
+    expect( ( events.keys[3].mod & key::MOD_Shift ) == 0, "releasing Shift clears it" );
+
+    const auto& locked = events.keys[6];
+    expect( locked.key == 'a' && ( locked.mod & key::MOD_CapsLock ) != 0, "Caps_Lock latches until pressed again" );
+    expect( events.keys[7].pressed && events.keys[7].key == 'a', "autorepeat is reported as another press" );
+    expect( !events.keys[8].pressed, "A release after autorepeat" );
+
+    const auto& keypad = events.keys[11];
+    expect( keypad.key == XK_KP_Home && keypad.modified == XK_KP_7, "Num_Lock selects the keypad digits" );
+    expect( ( keypad.mod & key::MOD_NumLock ) != 0, "Num_Lock latches until pressed again" );
+
+    for( size_t i = 1; i < events.keys.size(); ++i )
+    {
+        expect( events.keys[i].time > events.keys[i - 1].time, "records carry the kernel times of their reports" );
+    }
+    expect( input->DeviceCount() == 0, "the device is dropped at end of stream" );
+}
+
+void run_locks()
+{
+    // a caller's table, with a Meta key the built-in layout does not have
+    keycode_map::code_map codes{};
+    codes[KEY_NUMLOCK + 8]  = { XK_Num_Lock, XK_Num_Lock };
+    codes[KEY_LEFTMETA + 8] = { XK_Meta_L, XK_Meta_L };
+    codes[KEY_KP7 + 8]      = { XK_KP_Home, XK_KP_7 };
+
+    ref_ptr<LinuxInput> input( new LinuxInput( nullptr, codes ) );
+    replay_t replay;
+    input->AddDevice( replay.fds[0], true );
+
+    recording_t recording;
+    recording.key( KEY_NUMLOCK, 1 ).key( KEY_NUMLOCK, 0 ).key( KEY_LEFTMETA, 1 ).key( KEY_KP7, 1 ).key( KEY_KP7, 0 );
+    recording.key( KEY_LEFTMETA, 0 ).key( KEY_KP7, 1 ).key( KEY_KP7, 0 );
+    replay.send( recording );
+
+    typed_events_t events;
+    input->PollEvents( events );
+    expect( events.keys.size() == 8, "one record per key change" );
+    if( events.keys.size() != 8 ) return;
+
+    const auto& held = events.keys[3];
+    expect( ( held.mod & key::MOD_Alt ) != 0 && held.modified == XK_KP_7, "Meta is held alongside the latched Num_Lock" );
+    const auto& released = events.keys[6];
+    expect( ( released.mod & key::MOD_Alt ) == 0, "releasing Meta clears it" );
+    expect( ( released.mod & key::MOD_NumLock ) != 0 && released.modified == XK_KP_7, "releasing Meta leaves Num_Lock latched" );
+}
+
+//-----------------------------------------------------------------------------------------------//
+//                                   POINTER                                                    //
+//-----------------------------------------------------------------------------------------------//
+void run_pointer()
+{
+    ref_ptr<LinuxInput> input( new LinuxInput );
+    input->SetPointerBounds( 100, 100 );
+    replay_t replay;
+    input->AddDevice( replay.fds[0], true );
+
+    // motion past the bounds, a click at the clamped position, a wheel detent, and an
+    // overflow whose incomplete report must be discarded
+    recording_t recording;
+    recording.add( EV_REL, REL_X, 30 ).add( EV_REL, REL_Y, 20 ).report();
+    recording.add( EV_REL, REL_X, 200 ).add( EV_KEY, BTN_LEFT, 1 ).report();
+    recording.add( EV_KEY, BTN_LEFT, 0 ).add( EV_REL, REL_WHEEL, -1 ).report();
+    recording.add( EV_REL, REL_X, -50 ).add( EV_SYN, SYN_DROPPED, 0 ).report();
+    recording.add( EV_REL, REL_Y, 5 ).report();
+    replay.send( recording );
+    replay.finish();
+
+    Events objects;
+    input->PollEvents( objects );
+    size_t moves = 0, downs = 0, ups = 0, scrolls = 0, raw = 0;
+    for( auto& event : objects )
+    {
+        moves   += dynamic_cast<MouseMoveEvent*>( event.get() ) && !dynamic_cast<MouseRawMotionEvent*>( event.get() );
+        downs   += dynamic_cast<MouseDownEvent*>( event.get() ) && !dynamic_cast<MouseUpEvent*>( event.get() );
+        ups     += dynamic_cast<MouseUpEvent*>( event.get() ) != nullptr;
+        scrolls += dynamic_cast<MouseScrollEvent*>( event.get() ) != nullptr;
+        raw     += dynamic_cast<MouseRawMotionEvent*>( event.get() ) != nullptr;
+    }
+    expect( moves == 3 && raw == 3, "one move and one raw motion per report that moved" );
+    expect( downs == 1 && ups == 1 && scrolls == 1, "one event per button change and wheel detent" );
+    expect( !input->PollEvents( objects ), "a poll that adds nothing reports nothing, whatever the list held" );
+
+    // the same capture through the typed path
+    ref_ptr<LinuxInput> typed_input( new LinuxInput );
+    typed_input->SetPointerBounds( 100, 100 );
+    replay_t typed_replay;
+    typed_input->AddDevice( typed_replay.fds[0], true );
+    typed_replay.send( recording );
+    typed_replay.finish();
+
+    typed_events_t events;
+    typed_input->PollEvents( events );
+    std::vector<mouse_record_t> moved, pressed;
+    for( auto& record : events.mouse )
+    {
+        if( record.kind == mouse_record_t::MOVE ) moved.push_back( record );
+        if( record.kind == mouse_record_t::DOWN || record.kind == mouse_record_t::UP || record.kind == mouse_record_t::SCROLL ) pressed.push_back( record );
+    }
+    expect( moved.size() == 3, "typed path: one move per report that moved" );
+    expect( pressed.size() == 3, "typed path: press, release and scroll" );
+    if( moved.size() != 3 || pressed.size() != 3 ) return;
+
+    expect( moved[0].x == 30 && moved[0].y == 20, "relative motion accumulates" );
+    expect( moved[1].x == 99 && moved[1].y == 20, "relative motion is clamped to the bounds" );
+    expect( moved[2].x == 99 && moved[2].y == 25, "the report after an overflow is applied" );
+    expect( pressed[0].kind == mouse_record_t::DOWN && pressed[0].button == MOUSE_Left && pressed[0].x == 99, "press at the clamped position" );
+    // within a report the wheel goes out before the buttons
+    expect( pressed[1].kind == mouse_record_t::SCROLL && pressed[1].dy == -1, "one detent down" );
+    expect( pressed[2].kind == mouse_record_t::UP && pressed[2].button == MOUSE_Left, "release" );
+}
+
+//-----------------------------------------------------------------------------------------------//
+//                                   EVENT POOL                                                  //
+//-----------------------------------------------------------------------------------------------//
+void run_pool()
+{
+    ref_ptr<LinuxInput> input( new LinuxInput );
+    replay_t replay;
+    input->AddDevice( replay.fds[0], true );
+
+    recording_t recording;
+    recording.add( EV_REL, REL_X, 1 ).add( EV_REL, REL_Y, 1 ).report();
+    recording.add( EV_REL, REL_WHEEL, 1 ).add( EV_KEY, BTN_LEFT, 1 ).report();
+    recording.add( EV_KEY, BTN_LEFT, 0 ).report().key( KEY_A, 1 ).key( KEY_A, 0 );
+
+    // the first poll fills the input's pool; after that every event object is recycled.
+    // The list nodes holding them in Events still come from the heap
+    Events events;
+    replay.send( recording );
+    input->PollEvents( events );
+    const auto emitted = events.size();
+    events.clear();
+
+    const auto before = event_pool::stats();
+    constexpr uint64_t polls = 100;
+    for( uint64_t i = 0; i < polls; ++i )
+    {
+        replay.send( recording );
+        input->PollEvents( events );
+        events.clear();
+    }
+    const auto after = event_pool::stats();
+    expect( after.allocations == before.allocations, "repeated polls take no event objects from the heap" );
+    expect( after.recycled - before.recycled == polls * emitted, "every event object of a repeated poll is recycled" );
+
+    // a second input has a pool of its own, which the first one's free blocks do not fill
+    ref_ptr<LinuxInput> other( new LinuxInput );
+    replay_t other_replay;
+    other->AddDevice( other_replay.fds[0], true );
+    other_replay.send( recording );
+    other->PollEvents( events );
+    expect( event_pool::stats().allocations - after.allocations == emitted, "each input takes its first blocks from the heap" );
+
+    // events may outlive their input, and be dropped on another thread
+    other = {};
+    std::thread( [&events] { events.clear(); } ).join();
+    replay.send( recording );
+    input->PollEvents( events );
+    expect( event_pool::stats().allocations - after.allocations == emitted, "the other input's blocks never reach this one" );
+    events.clear();
+}
+
+} // namespace aer::test
+
+int main()
+{
+    aer::test::run_keys();
+    aer::test::run_locks();
+    aer::test::run_pointer();
+    aer::test::run_pool();
+    return aer::test::finish();
+}
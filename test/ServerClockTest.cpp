@@ -0,0 +1,125 @@
+// Maps synthetic X timestamps through server_clock, for a server on this machine and a remote
+// one, and checks the log2 buckets of latency_histogram_t. Needs no X server.
+//
+//  usage: aer_linux_server_clock_test
+
+#include <Graphics/XCBConnection.h>
+#include <Input/EventTime.h>
+
+#include "Expect.h"
+
+#include <chrono>
+
+namespace aer::test
+{
+
+using namespace std::chrono_literals;
+using xcb::server_clock;
+using clock = server_clock::clock;
+
+// the low 32 bits of a local time in milliseconds, as a server on this machine stamps it
+xcb_timestamp_t local_stamp( clock::time_point time )
+{
+    return static_cast<xcb_timestamp_t>( std::chrono::duration_cast<std::chrono::milliseconds>( time.time_since_epoch() ).count() );
+}
+
+void run_same_clock()
+{
+    // far enough from the epoch that the low 32 bits have wrapped many times
+    const auto base = clock::time_point( 40'000'000'000ms + 250ms );
+    server_clock timestamps;
+
+    // the first event is already mapped exactly, however late it arrived
+    const auto converted = timestamps.convert( local_stamp( base - 7ms ), base );
+    expect( timestamps.same_clock(), "a server time near the local clock is on it" );
+    expect( converted == base - 7ms, "the first event keeps its real delay" );
+
+    const auto later = base + 2s;
+    expect( timestamps.convert( local_stamp( later - 1ms ), later ) == later - 1ms, "a fast event maps exactly" );
+    expect( timestamps.convert( local_stamp( later - 30ms ), later ) == later - 30ms, "a slow event keeps its delay" );
+    expect( timestamps.to_local( local_stamp( later - 5ms ) ) == later - 5ms, "to_local uses the same mapping" );
+}
+
+void run_wrap()
+{
+    // a remote server whose 32-bit counter is about to wrap, on an unrelated clock
+    const auto base = clock::time_point( 1000s );
+    const xcb_timestamp_t start = 0xffffff00;
+    server_clock timestamps;
+    expect( timestamps.convert( start, base ) == base, "the first remote event sets the offset" );
+    expect( !timestamps.same_clock(), "an unrelated server time is not on the local clock" );
+
+    auto previous = base;
+    bool monotonic = true;
+    for( uint32_t i = 1; i <= 512; ++i )
+    {
+        const auto converted = timestamps.convert( start + i, base + std::chrono::milliseconds( i ) );
+        monotonic &= converted - previous == 1ms;
+        previous = converted;
+    }
+    expect( monotonic, "timestamps keep counting across the 32-bit wrap" );
+    expect( timestamps.to_local( start + 512 ) == base + 512ms, "to_local after the wrap" );
+    expect( timestamps.to_local( start + 100 ) == base + 100ms, "to_local before the wrap" );
+}
+
+void run_drift()
+{
+    // a remote server clock running 200 ppm slow, every event delivered without delay
+    const auto base = clock::time_point( 1000s );
+    const xcb_timestamp_t start = 5'000'000;
+    server_clock timestamps;
+    timestamps.convert( start, base );
+
+    clock::duration lag{};
+    for( uint32_t second = 1; second <= 100; ++second )
+    {
+        const auto received = base + std::chrono::microseconds( second * 1'000'200 );
+        lag = received - timestamps.convert( start + second * 1000, received );
+    }
+    // without the creep the lag would have grown to 20 ms by now
+    expect( lag < 1ms, "the offset creeps to follow a slower server clock" );
+
+    // the creep is bounded by drift_ppm, so one delayed event cannot drag the offset along
+    const auto received = base + std::chrono::microseconds( 101 * 1'000'200 ) + 50ms;
+    const auto delayed = timestamps.convert( start + 101'000, received );
+    expect( received - delayed > 40ms, "a delayed event still shows its delay" );
+}
+
+void run_histogram()
+{
+    latency_histogram_t histogram;
+    histogram.record( -5us );
+    histogram.record( 0us );
+    histogram.record( 1us );
+    histogram.record( 3us );
+    histogram.record( 1000us );
+    histogram.record( 1024us );
+    histogram.record( std::chrono::hours( 24 * 365 ) );
+
+    expect( histogram.count == 7, "every sample is counted" );
+    expect( histogram.buckets[0] == 2, "negative and zero samples land in bucket 0" );
+    expect( histogram.buckets[1] == 1, "1 us lands in [1, 2)" );
+    expect( histogram.buckets[2] == 1, "3 us lands in [2, 4)" );
+    expect( histogram.buckets[10] == 1, "1000 us lands in [512, 1024)" );
+    expect( histogram.buckets[11] == 1, "1024 us lands in [1024, 2048)" );
+    expect( histogram.buckets[latency_histogram_t::num_buckets - 1] == 1, "huge samples land in the last bucket" );
+    expect( histogram.max == std::chrono::hours( 24 * 365 ), "max keeps the largest sample" );
+
+    expect( histogram.percentile( 0.0 ) == 1us, "the lowest quantile is bucket 0's bound" );
+    expect( histogram.percentile( 0.5 ) == 4us, "the median bucket's upper bound" );
+    expect( histogram.percentile( 0.8 ) == 2048us, "the 80th percentile bucket's upper bound" );
+
+    histogram.reset();
+    expect( histogram.count == 0 && histogram.mean() == 0us && histogram.percentile( 0.5 ) == 0us, "reset empties it" );
+}
+
+} // namespace aer::test
+
+int main()
+{
+    aer::test::run_same_clock();
+    aer::test::run_wrap();
+    aer::test::run_drift();
+    aer::test::run_histogram();
+    return aer::test::finish();
+}
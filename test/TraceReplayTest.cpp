@@ -0,0 +1,274 @@
+// Writes a trace of synthetic events through trace_writer, then maps it back and replays it in
+// FAST mode through XCBReplayWindow, checking the events and times that come out. Covers a window
+// recorded while reparented and an XInput device change in the middle of a scroll. Needs no X
+// server.
+//
+//  usage: aer_linux_trace_replay_test
+
+#include <Graphics/XCBReplayWindow.h>
+#include <Graphics/XCBTrace.h>
+#include <Input/TypedEvents.h>
+
+#include "Expect.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <unistd.h>
+
+#include <X11/keysym.h>
+#include <xcb/xinput.h>
+
+namespace aer::test
+{
+using clock = std::chrono::steady_clock;
+using std::chrono::milliseconds;
+
+constexpr xcb_window_t window = 0x200001;
+constexpr xcb_window_t root   = 0x100;
+constexpr xcb_window_t frame  = 0x400001;
+constexpr uint8_t      xinput_opcode = 131;
+constexpr uint16_t     device = 2;
+constexpr uint16_t     scroll_number = 3;
+
+// events as libxcb hands them out: 8 byte aligned, with full_sequence after the first 32 bytes
+struct event_buffer_t
+{
+    std::vector<uint64_t> storage;
+
+    template<typename T>
+    T* make( size_t size = sizeof( T ) )
+    {
+        storage.assign( ( std::max( size, sizeof( xcb_generic_event_t ) ) + 7 ) / 8, 0 );
+        return reinterpret_cast<T*>( storage.data() );
+    }
+    xcb_generic_event_t* get() { return reinterpret_cast<xcb_generic_event_t*>( storage.data() ); }
+};
+
+// a session as it would have been recorded: events stamped by a server whose clock is an hour
+// off ours and received with the same delay, so their local times are exactly the receipt times
+struct session_t
+{
+    clock::time_point           start;
+    xcb_timestamp_t             server_start;
+    std::vector<event_buffer_t> buffers;
+    std::vector<xcb::queued_event_t> batch;
+
+    session_t()
+    :   start( clock::now() - std::chrono::hours( 1 ) ),
+        server_start( static_cast<xcb_timestamp_t>( std::chrono::duration_cast<milliseconds>( clock::now().time_since_epoch() ).count() + 3'600'000 ) )
+    {
+        buffers.reserve( 64 );
+    }
+
+    xcb_timestamp_t     server( int ms ) const { return server_start + ms; }
+    clock::time_point   received( int ms ) const { return start + milliseconds( ms ); }
+
+    template<typename T>
+    T* add( int ms, size_t size = sizeof( T ) )
+    {
+        auto& buffer = buffers.emplace_back();
+        auto event   = buffer.make<T>( size );
+        batch.push_back( { buffer.get(), received( ms ) } );
+        return event;
+    }
+
+    void key( int ms, uint8_t response_type, xcb_keycode_t keycode )
+    {
+        auto key = add<xcb_key_press_event_t>( ms );
+        key->response_type = response_type;
+        key->detail        = keycode;
+        key->time          = server( ms );
+        key->event         = window;
+        key->root          = root;
+    }
+
+    void configure( int ms, int16_t x, int16_t y, uint16_t width, uint16_t height )
+    {
+        auto configure = add<xcb_configure_notify_event_t>( ms );
+        configure->response_type = XCB_CONFIGURE_NOTIFY;
+        configure->event         = window;
+        configure->window        = window;
+        configure->x             = x;
+        configure->y             = y;
+        configure->width         = width;
+        configure->height        = height;
+    }
+
+    // XI_Motion carrying x, y and the scroll valuator
+    void motion( int ms, double x, double y, double scroll )
+    {
+        const uint16_t valuators_len = 1;
+        const uint32_t mask = 1u << 0 | 1u << 1 | 1u << scroll_number;
+        const double values[] = { x, y, scroll };
+        const size_t size = sizeof( xcb_input_motion_event_t ) + 4 * valuators_len + sizeof( values );
+
+        auto motion = add<xcb_input_motion_event_t>( ms, size );
+        motion->response_type = XCB_GE_GENERIC;
+        motion->extension     = xinput_opcode;
+        motion->length        = static_cast<uint32_t>( ( size - sizeof( xcb_generic_event_t ) ) / 4 );
+        motion->event_type    = XCB_INPUT_MOTION;
+        motion->deviceid      = device;
+        motion->sourceid      = device;
+        motion->time          = server( ms );
+        motion->root          = root;
+        motion->event         = window;
+        motion->event_x       = static_cast<xcb_input_fp1616_t>( x * 65536 );
+        motion->event_y       = static_cast<xcb_input_fp1616_t>( y * 65536 );
+        motion->valuators_len = valuators_len;
+
+        auto bytes = reinterpret_cast<std::byte*>( motion + 1 );
+        std::memcpy( bytes, &mask, sizeof( mask ) );
+        auto axes = reinterpret_cast<xcb_input_fp3232_t*>( bytes + 4 * valuators_len );
+        for( size_t i = 0; i < std::size( values ); ++i ) axes[i] = { static_cast<int32_t>( values[i] ), 0 };
+    }
+
+    // XI_DeviceChanged listing a single vertical scroll class
+    void device_changed( int ms, double increment )
+    {
+        const size_t size = sizeof( xcb_input_device_changed_event_t ) + sizeof( xcb_input_scroll_class_t );
+        auto changed = add<xcb_input_device_changed_event_t>( ms, size );
+        changed->response_type = XCB_GE_GENERIC;
+        changed->extension     = xinput_opcode;
+        changed->length        = static_cast<uint32_t>( ( size - sizeof( xcb_generic_event_t ) ) / 4 );
+        changed->event_type    = XCB_INPUT_DEVICE_CHANGED;
+        changed->deviceid      = device;
+        changed->sourceid      = device;
+        changed->time          = server( ms );
+        changed->num_classes   = 1;
+        changed->reason        = XCB_INPUT_CHANGE_REASON_DEVICE_CHANGE;
+
+        auto scroll = reinterpret_cast<xcb_input_scroll_class_t*>( changed + 1 );
+        scroll->type        = XCB_INPUT_DEVICE_CLASS_TYPE_SCROLL;
+        scroll->len         = sizeof( xcb_input_scroll_class_t ) / 4;
+        scroll->sourceid    = device;
+        scroll->number      = scroll_number;
+        scroll->scroll_type = XCB_INPUT_SCROLL_TYPE_VERTICAL;
+        scroll->increment   = { static_cast<int32_t>( increment ), 0 };
+    }
+
+    // writes the batch as one PollEvents dispatched at ms
+    void write( xcb::trace_writer& writer, int ms )
+    {
+        writer.write( received( ms ), batch );
+        batch.clear();
+    }
+};
+
+xcb::trace_header_t make_header()
+{
+    xcb::trace_header_t header{};
+    header.window          = window;
+    header.root            = root;
+    header.parent          = frame;
+    header.delete_protocol = 0x42;
+    header.x               = 10;
+    header.y               = 20;
+    header.width           = 640;
+    header.height          = 480;
+    header.xinput_opcode   = xinput_opcode;
+    header.pointer_input   = 1;
+    header.keymap[38]      = { XK_a, XK_A };
+    header.num_scroll_valuators = 1;
+    header.scroll_valuators[0]  = { device, scroll_number, false, 15.0, std::nullopt };
+    return header;
+}
+
+//-----------------------------------------------------------------------------------------------//
+//                                   REPLAY                                                      //
+//-----------------------------------------------------------------------------------------------//
+void run_replay()
+{
+    char path[] = "/tmp/aer_linux_trace_XXXXXX";
+    const int fd = mkstemp( path );
+    expect( fd >= 0, "a temporary trace file is created" );
+    if( fd < 0 ) return;
+    close( fd );
+
+    session_t session;
+    {
+        ref_ptr<xcb::trace_writer> writer( new xcb::trace_writer( path, make_header() ) );
+        expect( writer->valid(), "the trace is opened for writing" );
+
+        session.key( 0, XCB_KEY_PRESS, 38 );
+        session.key( 10, XCB_KEY_RELEASE, 38 );
+        session.write( *writer.get(), 11 );
+
+        // frame-relative coordinates, which say nothing about where the window is on the root
+        session.configure( 20, 5, 6, 800, 600 );
+        session.write( *writer.get(), 21 );
+
+        // a scroll of 30 units at 15 per detent, then the device changes to 30 per detent
+        session.motion( 30, 50, 60, 100 );
+        session.motion( 40, 51, 60, 130 );
+        session.device_changed( 45, 30 );
+        session.motion( 50, 52, 60, 200 );
+        session.motion( 60, 53, 60, 260 );
+        session.write( *writer.get(), 61 );
+        writer->flush();
+    }
+
+    ref_ptr<XCBReplayWindow> replay( new XCBReplayWindow( path, XCBReplayWindow::pacing::FAST ) );
+    unlink( path );
+
+    // the replay shifts the recording so its first batch is dispatched at the first poll
+    typed_events_t keys;
+    const auto before = clock::now();
+    expect( replay->PollEvents( keys ), "the first poll replays the first batch" );
+    const auto after = clock::now();
+    expect( keys.keys.size() == 2 && keys.mouse.empty() && keys.window.empty(), "one record per recorded key event" );
+    if( keys.keys.size() != 2 ) return;
+
+    const auto offset = keys.keys[0].time - session.received( 0 );
+    expect( offset >= before - session.received( 11 ) && offset <= after - session.received( 11 ), "times are shifted by the start of the replay" );
+    expect( keys.keys[0].pressed && keys.keys[0].key == XK_a && keys.keys[0].modified == XK_a, "the key press translates with the recorded keymap" );
+    expect( !keys.keys[1].pressed && keys.keys[1].key == XK_a, "the key release" );
+    expect( keys.keys[1].time == session.received( 10 ) + offset, "event times keep their recorded spacing" );
+
+    typed_events_t configure;
+    replay->PollEvents( configure );
+    expect( configure.window.size() == 1, "one configure per recorded batch" );
+    if( configure.window.size() == 1 )
+    {
+        const auto& geometry = configure.window[0];
+        expect( geometry.kind == window_record_t::CONFIGURE && geometry.width == 800 && geometry.height == 600, "the recorded size" );
+        expect( geometry.x == 10 && geometry.y == 20, "frame-relative coordinates of a reparented window are not taken as root coordinates" );
+        expect( geometry.time == session.received( 20 ) + offset, "a configure is stamped with its receipt time" );
+    }
+
+    typed_events_t pointer;
+    replay->PollEvents( pointer );
+    std::vector<mouse_record_t> moves, scrolls;
+    for( auto& record : pointer.mouse )
+    {
+        if( record.kind == mouse_record_t::MOVE ) moves.push_back( record );
+        if( record.kind == mouse_record_t::SMOOTH_SCROLL ) scrolls.push_back( record );
+    }
+    expect( moves.size() == 4, "one move per recorded motion" );
+    expect( scrolls.size() == 2, "the device change splits the scroll in two" );
+    if( moves.size() == 4 )
+    {
+        expect( moves[0].x == 50 && moves[3].x == 53 && moves[3].y == 60, "motion positions" );
+        expect( moves[0].time == session.received( 30 ) + offset && moves[3].time == session.received( 60 ) + offset, "motion times" );
+    }
+    if( scrolls.size() == 2 )
+    {
+        expect( scrolls[0].dy == -2.0 && scrolls[0].dx == 0.0, "two detents at the recorded increment" );
+        expect( scrolls[1].dy == -2.0, "two detents at the increment of the device change" );
+        expect( scrolls[1].time == session.received( 60 ) + offset, "a scroll is stamped with its last motion" );
+    }
+
+    expect( replay->Finished(), "every batch has been replayed" );
+    typed_events_t none;
+    expect( !replay->PollEvents( none ), "a finished replay reports nothing" );
+}
+
+} // namespace aer::test
+
+int main()
+{
+    aer::test::run_replay();
+    return aer::test::finish();
+}